@@ -1,10 +1,11 @@
 #version 460 core
 
 in vec2 texCoords;
+flat in int layer;
 out vec4 color;
 
-uniform sampler2D tileAtlas;
+layout (binding = 0) uniform sampler2DArray tileAtlas;
 
 void main() {
-    color = texture(tileAtlas, texCoords);
+    color = texture(tileAtlas, vec3(texCoords, float(layer)));
 }
\ No newline at end of file
@@ -1,14 +1,61 @@
 #version 460 core
 
-layout (location = 0) in vec2 pos;
-layout (location = 1) in vec2 uv;
+// tile and chunk dimensions (must match chunk.h)
+const int TILE_PIXELS_X = 16;
+const int TILE_PIXELS_Y = 16;
+const int CHUNK_TILES_X = 32;
+const int CHUNK_TILES_Y = 32;
+const int CHUNK_TILES = CHUNK_TILES_X * CHUNK_TILES_Y;
+
+// tile quad corners, one per vertex of the two triangles
+const ivec2 CORNERS[6] = ivec2[6](
+    ivec2(0, 0), ivec2(1, 0), ivec2(1, 1),
+    ivec2(0, 0), ivec2(0, 1), ivec2(1, 1)
+);
+
 out vec2 texCoords;
+flat out int layer;
+
+// binding points (must match chunk_renderer.h)
+layout (std140, binding = 0) uniform CameraBlock {
+    mat4 projection;
+    mat4 view;
+};
+
+// tiles of every chunk slot, two per uint (id low byte, autotile variant
+// high byte)
+layout (std430, binding = 0) readonly buffer TilesBlock {
+    uint tiles[];
+};
+
+// chunk position of every slot
+layout (std430, binding = 1) readonly buffer PositionsBlock {
+    ivec2 positions[];
+};
 
-uniform mat4 projection;
-uniform mat4 view;
+uniform int autotileStride; // 0 draws the id layer, 47 the blob variant layer
 
 void main() {
 
+    // one draw per chunk slot (baseInstance), one instance per tile, six
+    // vertices per instance
+    int slot = gl_BaseInstance;
+    ivec2 tile = ivec2(gl_InstanceID % CHUNK_TILES_X, gl_InstanceID / CHUNK_TILES_X);
+    ivec2 corner = CORNERS[gl_VertexID];
+
+    int i = slot * CHUNK_TILES + gl_InstanceID;
+    uint word = (tiles[i >> 1] >> ((i & 1) * 16)) & 0xFFFFu;
+    int id = int(word & 0xFFu);
+    int variant = int(word >> 8);
+
+    // chunk (0, 0) is centered on the world origin
+    ivec2 chunkPixels = ivec2(CHUNK_TILES_X * TILE_PIXELS_X, CHUNK_TILES_Y * TILE_PIXELS_Y);
+    ivec2 offset = positions[slot] * chunkPixels - chunkPixels / 2;
+    vec2 pos = vec2(offset + (tile + corner) * ivec2(TILE_PIXELS_X, TILE_PIXELS_Y));
+
     gl_Position = projection * view * vec4(pos, 0.0f, 1.0f);
-    texCoords = uv;
+
+    // every tile is its own atlas layer
+    layer = autotileStride > 0 ? id * autotileStride + variant : id;
+    texCoords = vec2(corner);
 }
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 460 core
+
+in vec2 texCoords;
+out vec4 color;
+
+// single channel glyph coverage (unit must match debug_screen.h)
+layout (binding = 0) uniform sampler2D glyphs;
+
+uniform vec3 textColor;
+
+void main() {
+    color = vec4(textColor, texture(glyphs, texCoords).r);
+}
@@ -0,0 +1,34 @@
+#version 460 core
+
+// quad corners, one per vertex of the two triangles
+const ivec2 CORNERS[6] = ivec2[6](
+    ivec2(0, 0), ivec2(1, 0), ivec2(1, 1),
+    ivec2(0, 0), ivec2(1, 1), ivec2(0, 1)
+);
+
+// screen rectangle in pixels from the top left corner, then atlas rectangle
+struct Glyph {
+    vec4 rect;
+    vec4 texRect;
+};
+
+out vec2 texCoords;
+
+// glyphs of the frame (binding must match debug_screen.h)
+layout (std430, binding = 3) readonly buffer GlyphsBlock {
+    Glyph glyphs[];
+};
+
+uniform vec2 screenSize;
+
+void main() {
+
+    // one instance per glyph, baseInstance is the start of the frame's region
+    Glyph glyph = glyphs[gl_BaseInstance + gl_InstanceID];
+    vec2 corner = vec2(CORNERS[gl_VertexID]);
+
+    vec2 pos = mix(glyph.rect.xy, glyph.rect.zw, corner);
+    vec2 ndc = pos / screenSize * 2.0f - 1.0f;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0f, 1.0f);
+    texCoords = mix(glyph.texRect.xy, glyph.texRect.zw, corner);
+}
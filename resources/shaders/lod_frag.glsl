@@ -0,0 +1,16 @@
+#version 460 core
+
+in vec3 texCoords;
+out vec4 color;
+
+// one layer per super-chunk, one texel per tile (unit must match chunk_lod.h)
+layout (binding = 1) uniform sampler2DArray superChunks;
+
+void main() {
+    color = texture(superChunks, texCoords);
+
+    // chunks that are not loaded
+    if (color.a == 0.0f) {
+        discard;
+    }
+}
@@ -0,0 +1,39 @@
+#version 460 core
+
+// tile and chunk dimensions (must match chunk.h and chunk_lod.h)
+const int TILE_PIXELS_X = 16;
+const int TILE_PIXELS_Y = 16;
+const int CHUNK_TILES_X = 32;
+const int CHUNK_TILES_Y = 32;
+const int LOD_SUPER_CHUNKS = 4;
+
+// quad corners, one per vertex of the two triangles
+const ivec2 CORNERS[6] = ivec2[6](
+    ivec2(0, 0), ivec2(1, 0), ivec2(1, 1),
+    ivec2(0, 0), ivec2(0, 1), ivec2(1, 1)
+);
+
+out vec3 texCoords;
+
+// super-chunk position of every slot (binding must match chunk_lod.h)
+layout (std430, binding = 2) readonly buffer SuperPositionsBlock {
+    ivec2 superPositions[];
+};
+
+uniform mat4 projection;
+uniform mat4 view;
+
+void main() {
+
+    // one draw per super-chunk slot (baseInstance), one quad per draw
+    int slot = gl_BaseInstance;
+    ivec2 corner = CORNERS[gl_VertexID];
+
+    // chunk (0, 0) is centered on the world origin
+    ivec2 chunkPixels = ivec2(CHUNK_TILES_X * TILE_PIXELS_X, CHUNK_TILES_Y * TILE_PIXELS_Y);
+    ivec2 offset = superPositions[slot] * LOD_SUPER_CHUNKS * chunkPixels - chunkPixels / 2;
+    vec2 pos = vec2(offset + corner * LOD_SUPER_CHUNKS * chunkPixels);
+
+    gl_Position = projection * view * vec4(pos, 0.0f, 1.0f);
+    texCoords = vec3(vec2(corner), float(slot));
+}
@@ -5,15 +5,27 @@
 #include "types.h"
 #include "camera.h"
 #include "chunk_manager.h"
-// #include "debug_screen.h"
+#include "debug_screen.h"
+#include "profiler.h"
+#include "shader_watcher.h"
+#include "simulation.h"
 
 // third party includes
 #include <GL/glew.h>
 #include <SDL.h>
 
 // STL includes
+#include <cstdio>
 #include <iostream>
 #include <random>
+#include <string>
+#include <vector>
+
+// definitions
+#define CAMERA_SPEED 480.0f // pixels per second
+#define UNIT_COUNT 50000 // units spawned at start
+#define PROFILER_TRACE_FILEPATH "profile_trace.json"
+#define PROFILER_TRACE_FRAMES 300
 
 // =============================================================================
 // Application Class
@@ -27,8 +39,10 @@ class Application {
 
     private:
         void handleInputEvents();
+        void updateDebugScreen();
 
         bool isRunning = true;
+        bool isDebugScreenVisible = true;
         int screenX = 800;
         int screenY = 600;
         int mouseX = 0;
@@ -43,8 +57,12 @@ class Application {
         SDL_GLContext context = nullptr;
 
         Camera camera;
+        Simulation simulation;
         ChunkManager chunkManager;
-        // DebugScreen debugScreen;
+        ShaderWatcher shaderWatcher;
+        Profiler profiler;
+        DebugScreen debugScreen;
+        std::vector<std::string> debugLines;
 };
 
 // =============================================================================
@@ -117,17 +135,29 @@ Application::Application() {
     // camera.initPerspective(screenX, screenY);
     // camera.initView(0.0, 0.0, -0.0001);
 
-    // setup chunk manager
-    chunkManager.update({0.0, 0.0, 0.0});
+    // setup simulation, which owns the camera position from now on
+    SimState initial;
+    initial.cameraPos.x = camera.pos.x;
+    initial.cameraPos.y = camera.pos.y;
+    simulation.start(initial, UNIT_COUNT, seed);
 
-    // // setup debug screen
-    // debugScreen.init();
+    // setup chunk manager
+    chunkManager.setSeed(seed);
+    chunkManager.init(camera);
+    chunkManager.update(camera);
+    chunkManager.watchShaders(shaderWatcher);
+
+    // setup debug screen
+    debugScreen.init(screenX, screenY);
+    shaderWatcher.watch(debugScreen.getShader());
+    profiler.init();
 }
 
 // =============================================================================
 // Destruct Application
 // =============================================================================
 Application::~Application() {
+    simulation.stop();
     SDL_DestroyWindow(window);
     SDL_GL_DeleteContext(context);
     SDL_Quit();
@@ -164,20 +194,28 @@ void Application::handleInputEvents() {
                     isRunning = false;
                     break;
                 }
+                case SDLK_F3: {
+                    isDebugScreenVisible = !isDebugScreenVisible;
+                    break;
+                }
+                case SDLK_F4: {
+                    profiler.startTrace(PROFILER_TRACE_FILEPATH, PROFILER_TRACE_FRAMES);
+                    break;
+                }
                 case SDLK_UP: {
-                    cameraVelY = -8.0f;
+                    cameraVelY = -CAMERA_SPEED;
                     break;
                 }
                 case SDLK_DOWN: {
-                    cameraVelY = 8.0f;
+                    cameraVelY = CAMERA_SPEED;
                     break;
                 }
                 case SDLK_LEFT: {
-                    cameraVelX = -8.0f;
+                    cameraVelX = -CAMERA_SPEED;
                     break;
                 }
                 case SDLK_RIGHT: {
-                    cameraVelX = 8.0f;
+                    cameraVelX = CAMERA_SPEED;
                     break;
                 }
             }
@@ -214,6 +252,8 @@ void Application::handleInputEvents() {
             isRunning = false;
         }
     }
+
+    simulation.setCameraVelocity({{cameraVelX, cameraVelY}});
 }
 
 // =============================================================================
@@ -223,27 +263,91 @@ void Application::run() {
 
     // loop
     while(isRunning) {
+        profiler.beginFrame();
 
         // handle input events
-        handleInputEvents();
+        {
+            ProfileScope scope(profiler, "input");
+            handleInputEvents();
+        }
 
-        // update objects
-        if(cameraVelX != 0 || cameraVelY != 0) {
-            camera.moveView(
-                camera.pos.x + cameraVelX,
-                camera.pos.y + cameraVelY
-            );
+        // update objects from the simulation, interpolated between its ticks
+        {
+            ProfileScope scope(profiler, "update");
+            SimState prev, curr;
+            float alpha = simulation.getRenderState(prev, curr);
+            vec2f_t cameraMove;
+            cameraMove.x = prev.cameraPos.x + (curr.cameraPos.x - prev.cameraPos.x) * alpha - camera.pos.x;
+            cameraMove.y = prev.cameraPos.y + (curr.cameraPos.y - prev.cameraPos.y) * alpha - camera.pos.y;
+            if(cameraMove.x != 0 || cameraMove.y != 0) {
+                camera.moveView(
+                    camera.pos.x + cameraMove.x,
+                    camera.pos.y + cameraMove.y
+                );
+            }
 
-            // update chunks
-            chunkManager.update(camera.pos);
+            // update chunks (every frame to receive generated chunks)
+            ProfileScope chunkScope(profiler, "chunks");
+            chunkManager.update(camera, cameraMove);
+            simulation.getPathService().sync(chunkManager.getPathfinder());
         }
 
+        // reload edited shaders before they are used
+        shaderWatcher.update();
+
         // draw
-        glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-        chunkManager.render(camera);
+        {
+            ProfileScope scope(profiler, "render");
+            profiler.beginGpuScope("world");
+            glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+            chunkManager.render(camera);
+            profiler.endGpuScope();
+
+            if (isDebugScreenVisible) {
+                profiler.beginGpuScope("debug screen");
+                updateDebugScreen();
+                debugScreen.render();
+                profiler.endGpuScope();
+            }
+        }
 
         // update screen
-        SDL_GL_SwapWindow(window);
+        {
+            ProfileScope scope(profiler, "swap");
+            SDL_GL_SwapWindow(window);
+        }
+
+        profiler.endFrame();
+    }
+}
+
+// =============================================================================
+// Update Debug Screen
+// =============================================================================
+// Timings shown are from previous frames; the current one is still running.
+void Application::updateDebugScreen() {
+    char line[128];
+
+    debugLines.clear();
+    profiler.appendLines(debugLines);
+    std::snprintf(line, sizeof(line), "chunks %zu  meshes %zu  drawn %d",
+        chunkManager.getNumChunks(), chunkManager.getNumMeshes(), chunkManager.getNumDrawn());
+    debugLines.push_back(line);
+
+    SimState prev, curr;
+    simulation.getRenderState(prev, curr);
+    std::snprintf(line, sizeof(line), "tick %llu  units %zu  step %.3f ms",
+        (unsigned long long)curr.tick, curr.numUnits, curr.stepMs);
+    debugLines.push_back(line);
+
+    PathService& paths = simulation.getPathService();
+    std::snprintf(line, sizeof(line), "paths %zu requested  %zu searched  %zu queued  %.2f ms/tick",
+        paths.getNumRequested(), paths.getNumSearched(), paths.getNumQueued(), paths.getSpentMs());
+    debugLines.push_back(line);
+
+    debugScreen.clear();
+    for (const std::string& debugLine : debugLines) {
+        debugScreen.print(debugLine);
     }
 }
 
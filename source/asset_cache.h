@@ -0,0 +1,164 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+// local includes
+#include "mapped_file.h"
+
+// STL includes
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <system_error>
+
+// definitions
+#define ASSET_CACHE_MAGIC 0x41535452 // "RTSA"
+#define ASSET_CACHE_VERSION 1
+#define ASSET_CACHE_DIRECTORY "cache/assets"
+#define ASSET_HASH_SEED 0xCBF29CE484222325ull // FNV-1a 64 bit offset basis
+#define ASSET_HASH_PRIME 0x100000001B3ull
+
+// =============================================================================
+// Asset Cache File Layout
+// =============================================================================
+// One file per asset: a header followed by the blob.  key is the content
+// hash of the sources the blob was built from, so a changed source simply
+// misses and the blob is rebuilt.  Blobs start 8 byte aligned.
+struct AssetHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t key;
+    std::uint64_t size;
+};
+
+// =============================================================================
+// AssetBlob Class
+// =============================================================================
+// A cached blob mapped straight from its file.
+class AssetBlob {
+    public:
+        AssetBlob() {};
+        const std::uint8_t* getData() const { return file.getData() + sizeof(AssetHeader); };
+        size_t getSize() const { return size; };
+
+    private:
+        friend class AssetCache;
+
+        MappedFile file;
+        size_t size = 0;
+};
+
+// =============================================================================
+// AssetCache Class
+// =============================================================================
+// Pre-decoded assets (decoded images, rasterized glyphs) so startup maps a
+// file instead of decoding or rasterizing.  Callers hash their source files
+// with hash(), try load(), and on a miss build the blob from the sources
+// and store() it.
+class AssetCache {
+    public:
+        AssetCache(const std::string& directory = ASSET_CACHE_DIRECTORY) : directory(directory) {};
+        bool load(const std::string& name, std::uint64_t key, AssetBlob& blob);
+        bool store(const std::string& name, std::uint64_t key, const void* data, size_t size);
+        static std::uint64_t hash(const void* data, size_t size, std::uint64_t seed = ASSET_HASH_SEED);
+        static bool hashFile(const std::string& filepath, std::uint64_t& key);
+
+    private:
+        std::string getFilepath(const std::string& name) { return directory + "/" + name + ".bin"; };
+
+        std::string directory;
+};
+
+// =============================================================================
+// Load
+// =============================================================================
+// Maps the cached blob for name.  Fails if there is none or it was built
+// from different sources.
+bool AssetCache::load(const std::string& name, std::uint64_t key, AssetBlob& blob) {
+
+    if (!blob.file.open(getFilepath(name))) {
+        return false;
+    }
+
+    AssetHeader header;
+    if (blob.file.getSize() < sizeof(AssetHeader)) {
+        blob.file.close();
+        return false;
+    }
+    std::memcpy(&header, blob.file.getData(), sizeof(AssetHeader));
+
+    if (header.magic != ASSET_CACHE_MAGIC ||
+        header.version != ASSET_CACHE_VERSION ||
+        header.key != key ||
+        header.size > blob.file.getSize() - sizeof(AssetHeader)) {
+        blob.file.close();
+        return false;
+    }
+
+    blob.size = size_t(header.size);
+    return true;
+}
+
+// =============================================================================
+// Store
+// =============================================================================
+// Writes to a temporary file first so a reader never maps half a blob.
+bool AssetCache::store(const std::string& name, std::uint64_t key, const void* data, size_t size) {
+
+    std::error_code err;
+    std::filesystem::create_directories(directory, err);
+
+    std::string filepath = getFilepath(name);
+    std::string tempFilepath = filepath + ".tmp";
+
+    std::FILE* file = std::fopen(tempFilepath.c_str(), "wb");
+    if (file == nullptr) {
+        std::cout << "WARNING: could not write asset cache " << tempFilepath << std::endl;
+        return false;
+    }
+
+    AssetHeader header = {ASSET_CACHE_MAGIC, ASSET_CACHE_VERSION, key, std::uint64_t(size)};
+    bool isOk = std::fwrite(&header, sizeof(AssetHeader), 1, file) == 1 &&
+                (size == 0 || std::fwrite(data, size, 1, file) == 1);
+    isOk = std::fclose(file) == 0 && isOk;
+
+    if (isOk) {
+        std::filesystem::rename(tempFilepath, filepath, err);
+        isOk = !err;
+    }
+    if (!isOk) {
+        std::cout << "WARNING: could not write asset cache " << filepath << std::endl;
+        std::filesystem::remove(tempFilepath, err);
+    }
+    return isOk;
+}
+
+// =============================================================================
+// Hash
+// =============================================================================
+// FNV-1a, chained through seed so several sources hash into one key.
+std::uint64_t AssetCache::hash(const void* data, size_t size, std::uint64_t seed) {
+    const std::uint8_t* bytes = (const std::uint8_t*)data;
+    std::uint64_t h = seed;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * ASSET_HASH_PRIME;
+    }
+    return h;
+}
+
+// =============================================================================
+// Hash File
+// =============================================================================
+// Content hash of a whole file, chained into key.
+bool AssetCache::hashFile(const std::string& filepath, std::uint64_t& key) {
+    MappedFile file;
+    if (!file.open(filepath)) {
+        return false;
+    }
+    key = hash(file.getData(), file.getSize(), key);
+    return true;
+}
+
+#endif // ASSET_CACHE_H
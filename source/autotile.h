@@ -0,0 +1,251 @@
+#ifndef AUTOTILE_H
+#define AUTOTILE_H
+
+// local includes
+#include "chunk.h"
+
+// third party includes
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define AUTOTILE_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUTOTILE_SIMD_SSE2
+#endif
+
+// STL includes
+#include <cstdint>
+
+// definitions
+#define AUTOTILE_VARIANTS 47
+
+// neighbor bits (see docs/notes.md)
+//   0 1 2
+//   3 - 4
+//   5 6 7
+#define AUTOTILE_NW (1 << 0)
+#define AUTOTILE_N  (1 << 1)
+#define AUTOTILE_NE (1 << 2)
+#define AUTOTILE_W  (1 << 3)
+#define AUTOTILE_E  (1 << 4)
+#define AUTOTILE_SW (1 << 5)
+#define AUTOTILE_S  (1 << 6)
+#define AUTOTILE_SE (1 << 7)
+
+// type definitions
+typedef std::uint8_t PaddedTileArray2D [CHUNK_TILES_Y + 2][CHUNK_TILES_X + 2];
+
+// =============================================================================
+// Autotiler Class
+// =============================================================================
+// Blob autotiling.  A tile's mask has a bit set for every neighbor with the
+// same tile id.  Corner bits only count when both adjacent edges are set,
+// which leaves 47 distinct masks; those are numbered in ascending mask order
+// to give the variant (0 is an isolated tile, 46 a fully surrounded one).
+//
+// Whole chunks are masked from a padded copy of the tiles whose border holds
+// the neighboring chunks' edges.  Rows are compared 32 tiles at a time (one
+// AVX2 register or two SSE2 registers); every path gives the same result as
+// computeVariant().  Edits re-mask only a range of rows, which needs the
+// padded rows from one above to one below it.
+class Autotiler {
+    public:
+        static void computeVariants(const PaddedTileArray2D& tiles, TileArray2D& variants, bool isSimd = true);
+        static void computeVariants(const PaddedTileArray2D& tiles, TileArray2D& variants, int minY, int maxY, bool isSimd = true);
+        static std::uint8_t computeVariant(const std::uint8_t* up, const std::uint8_t* mid, const std::uint8_t* down);
+        static std::uint8_t getVariant(std::uint8_t mask) { return getTable().variants[mask]; };
+        static std::uint8_t getMask(std::uint8_t variant) { return getTable().masks[variant]; };
+        static const char* getKernelName();
+
+    private:
+        struct Table {
+            Table();
+            std::uint8_t variants[256];
+            std::uint8_t masks[AUTOTILE_VARIANTS];
+        };
+
+        static const Table& getTable() { static const Table table; return table; };
+        static std::uint8_t reduce(unsigned int mask);
+        static void computeRow(const std::uint8_t* up, const std::uint8_t* mid, const std::uint8_t* down, std::uint8_t* masks);
+};
+
+// =============================================================================
+// Construct Autotiler Table
+// =============================================================================
+Autotiler::Table::Table() {
+
+    // number the reduced masks in ascending order
+    int numVariants = 0;
+    std::uint8_t indices[256];
+    for (int mask = 0; mask < 256; mask++) {
+        indices[mask] = 0xFF;
+    }
+    for (int mask = 0; mask < 256; mask++) {
+        if (reduce(mask) == mask) {
+            indices[mask] = std::uint8_t(numVariants);
+            masks[numVariants] = std::uint8_t(mask);
+            numVariants++;
+        }
+    }
+
+    for (int mask = 0; mask < 256; mask++) {
+        variants[mask] = indices[reduce(mask)];
+    }
+}
+
+// =============================================================================
+// Reduce
+// =============================================================================
+// Clears corner bits whose adjacent edges are not both set.
+std::uint8_t Autotiler::reduce(unsigned int mask) {
+    if ((mask & (AUTOTILE_N | AUTOTILE_W)) != (AUTOTILE_N | AUTOTILE_W)) mask &= ~AUTOTILE_NW;
+    if ((mask & (AUTOTILE_N | AUTOTILE_E)) != (AUTOTILE_N | AUTOTILE_E)) mask &= ~AUTOTILE_NE;
+    if ((mask & (AUTOTILE_S | AUTOTILE_W)) != (AUTOTILE_S | AUTOTILE_W)) mask &= ~AUTOTILE_SW;
+    if ((mask & (AUTOTILE_S | AUTOTILE_E)) != (AUTOTILE_S | AUTOTILE_E)) mask &= ~AUTOTILE_SE;
+    return std::uint8_t(mask);
+}
+
+// =============================================================================
+// Compute Variant
+// =============================================================================
+// Variant of mid[1].  Each row pointer points at the tile left of the
+// column, so up[0..2], mid[0..2], and down[0..2] form the 3x3 neighborhood.
+std::uint8_t Autotiler::computeVariant(const std::uint8_t* up, const std::uint8_t* mid, const std::uint8_t* down) {
+
+    std::uint8_t c = mid[1];
+    unsigned int mask = 0;
+    if (up[0] == c)   mask |= AUTOTILE_NW;
+    if (up[1] == c)   mask |= AUTOTILE_N;
+    if (up[2] == c)   mask |= AUTOTILE_NE;
+    if (mid[0] == c)  mask |= AUTOTILE_W;
+    if (mid[2] == c)  mask |= AUTOTILE_E;
+    if (down[0] == c) mask |= AUTOTILE_SW;
+    if (down[1] == c) mask |= AUTOTILE_S;
+    if (down[2] == c) mask |= AUTOTILE_SE;
+
+    return getVariant(std::uint8_t(mask));
+}
+
+// =============================================================================
+// Compute Variants
+// =============================================================================
+void Autotiler::computeVariants(const PaddedTileArray2D& tiles, TileArray2D& variants, bool isSimd) {
+    computeVariants(tiles, variants, 0, CHUNK_TILES_Y - 1, isSimd);
+}
+
+void Autotiler::computeVariants(const PaddedTileArray2D& tiles, TileArray2D& variants, int minY, int maxY, bool isSimd) {
+
+    const Table& table = getTable();
+
+    for (int y = minY; y <= maxY; y++) {
+        if (isSimd) {
+            std::uint8_t masks[CHUNK_TILES_X];
+            computeRow(tiles[y], tiles[y + 1], tiles[y + 2], masks);
+            for (int x = 0; x < CHUNK_TILES_X; x++) {
+                variants[y][x] = table.variants[masks[x]];
+            }
+        }
+        else {
+            for (int x = 0; x < CHUNK_TILES_X; x++) {
+                variants[y][x] = computeVariant(&tiles[y][x], &tiles[y + 1][x], &tiles[y + 2][x]);
+            }
+        }
+    }
+}
+
+// =============================================================================
+// Compute Row
+// =============================================================================
+// Masks of one row of CHUNK_TILES_X tiles.  Rows are padded, so the tile
+// at x has its left neighbor at x and its right neighbor at x + 2.
+void Autotiler::computeRow(const std::uint8_t* up, const std::uint8_t* mid, const std::uint8_t* down, std::uint8_t* masks) {
+#if defined(AUTOTILE_SIMD_AVX2)
+    static_assert(CHUNK_TILES_X % 32 == 0, "row kernel processes 32 tiles at a time");
+    for (int x = 0; x < CHUNK_TILES_X; x += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(mid + x + 1));
+
+        __m256i n  = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(up + x + 1)), c);
+        __m256i w  = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(mid + x)), c);
+        __m256i e  = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(mid + x + 2)), c);
+        __m256i s  = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(down + x + 1)), c);
+
+        // corners only count next to two matching edges
+        __m256i nw = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(up + x)), c), _mm256_and_si256(n, w));
+        __m256i ne = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(up + x + 2)), c), _mm256_and_si256(n, e));
+        __m256i sw = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(down + x)), c), _mm256_and_si256(s, w));
+        __m256i se = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(down + x + 2)), c), _mm256_and_si256(s, e));
+
+        __m256i mask = _mm256_and_si256(nw, _mm256_set1_epi8(AUTOTILE_NW));
+        mask = _mm256_or_si256(mask, _mm256_and_si256(n,  _mm256_set1_epi8(AUTOTILE_N)));
+        mask = _mm256_or_si256(mask, _mm256_and_si256(ne, _mm256_set1_epi8(AUTOTILE_NE)));
+        mask = _mm256_or_si256(mask, _mm256_and_si256(w,  _mm256_set1_epi8(AUTOTILE_W)));
+        mask = _mm256_or_si256(mask, _mm256_and_si256(e,  _mm256_set1_epi8(AUTOTILE_E)));
+        mask = _mm256_or_si256(mask, _mm256_and_si256(sw, _mm256_set1_epi8(AUTOTILE_SW)));
+        mask = _mm256_or_si256(mask, _mm256_and_si256(s,  _mm256_set1_epi8(AUTOTILE_S)));
+        mask = _mm256_or_si256(mask, _mm256_and_si256(se, _mm256_set1_epi8((char)AUTOTILE_SE)));
+
+        _mm256_storeu_si256((__m256i*)(masks + x), mask);
+    }
+#elif defined(AUTOTILE_SIMD_SSE2)
+    static_assert(CHUNK_TILES_X % 16 == 0, "row kernel processes 16 tiles at a time");
+    for (int x = 0; x < CHUNK_TILES_X; x += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(mid + x + 1));
+
+        __m128i n  = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(up + x + 1)), c);
+        __m128i w  = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(mid + x)), c);
+        __m128i e  = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(mid + x + 2)), c);
+        __m128i s  = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(down + x + 1)), c);
+
+        // corners only count next to two matching edges
+        __m128i nw = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(up + x)), c), _mm_and_si128(n, w));
+        __m128i ne = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(up + x + 2)), c), _mm_and_si128(n, e));
+        __m128i sw = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(down + x)), c), _mm_and_si128(s, w));
+        __m128i se = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(down + x + 2)), c), _mm_and_si128(s, e));
+
+        __m128i mask = _mm_and_si128(nw, _mm_set1_epi8(AUTOTILE_NW));
+        mask = _mm_or_si128(mask, _mm_and_si128(n,  _mm_set1_epi8(AUTOTILE_N)));
+        mask = _mm_or_si128(mask, _mm_and_si128(ne, _mm_set1_epi8(AUTOTILE_NE)));
+        mask = _mm_or_si128(mask, _mm_and_si128(w,  _mm_set1_epi8(AUTOTILE_W)));
+        mask = _mm_or_si128(mask, _mm_and_si128(e,  _mm_set1_epi8(AUTOTILE_E)));
+        mask = _mm_or_si128(mask, _mm_and_si128(sw, _mm_set1_epi8(AUTOTILE_SW)));
+        mask = _mm_or_si128(mask, _mm_and_si128(s,  _mm_set1_epi8(AUTOTILE_S)));
+        mask = _mm_or_si128(mask, _mm_and_si128(se, _mm_set1_epi8((char)AUTOTILE_SE)));
+
+        _mm_storeu_si128((__m128i*)(masks + x), mask);
+    }
+#else
+    for (int x = 0; x < CHUNK_TILES_X; x++) {
+        std::uint8_t c = mid[x + 1];
+        bool n = up[x + 1] == c;
+        bool w = mid[x] == c;
+        bool e = mid[x + 2] == c;
+        bool s = down[x + 1] == c;
+
+        unsigned int mask = 0;
+        if (n && w && up[x] == c)       mask |= AUTOTILE_NW;
+        if (n)                          mask |= AUTOTILE_N;
+        if (n && e && up[x + 2] == c)   mask |= AUTOTILE_NE;
+        if (w)                          mask |= AUTOTILE_W;
+        if (e)                          mask |= AUTOTILE_E;
+        if (s && w && down[x] == c)     mask |= AUTOTILE_SW;
+        if (s)                          mask |= AUTOTILE_S;
+        if (s && e && down[x + 2] == c) mask |= AUTOTILE_SE;
+        masks[x] = std::uint8_t(mask);
+    }
+#endif
+}
+
+// =============================================================================
+// Get Kernel Name
+// =============================================================================
+const char* Autotiler::getKernelName() {
+#if defined(AUTOTILE_SIMD_AVX2)
+    return "avx2";
+#elif defined(AUTOTILE_SIMD_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+#endif // AUTOTILE_H
@@ -0,0 +1,1054 @@
+// Headless chunk pipeline benchmark.
+//
+// Built with RTS_HEADLESS so no SDL window or OpenGL context is required.
+// Usage: rts-engine-benchmark [steps]
+
+// local includes
+#include "types.h"
+#include "asset_cache.h"
+#include "autotile.h"
+#include "camera.h"
+#include "chunk.h"
+#include "chunk_atlas.h"
+#include "chunk_mesh.h"
+#include "chunk_manager.h"
+#include "path_service.h"
+#include "terrain.h"
+#include "tile_storage.h"
+#include "units.h"
+
+// STL includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// allocator block sizes
+#if defined(_WIN32)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+// definitions
+#define BENCHMARK_WARMUP 16
+#define BENCHMARK_SAMPLES 1000
+#define BENCHMARK_PAN_STEPS 200
+
+// =============================================================================
+// Allocation Tracking
+// =============================================================================
+static std::atomic<size_t> numAllocs(0);
+static std::atomic<size_t> numLiveBytes(0);
+
+// live bytes are counted in the allocator's usable size of each block, which
+// it already knows, so unsized deletes need no header of our own
+static size_t getAllocSize(void* p) {
+#if defined(_WIN32)
+    return _msize(p);
+#elif defined(__APPLE__)
+    return malloc_size(p);
+#else
+    return malloc_usable_size(p);
+#endif
+}
+
+// called through a pointer the compiler cannot see through, so a delete
+// inlined next to its new does not look like free() on a new'd pointer
+static void (*volatile freeBlock)(void*) = std::free;
+
+void* operator new(size_t size) {
+    void* p = std::malloc(size > 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    numAllocs++;
+    numLiveBytes += getAllocSize(p);
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+    numLiveBytes -= getAllocSize(p);
+    freeBlock(p);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+
+// =============================================================================
+// Timing Statistics
+// =============================================================================
+struct Stats {
+    double median;
+    double p99;
+    double mean;
+};
+
+Stats computeStats(std::vector<double>& samples) {
+    Stats stats = {0.0, 0.0, 0.0};
+    if (samples.empty()) {
+        return stats;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0.0;
+    for (double s : samples) {
+        sum += s;
+    }
+
+    size_t n = samples.size();
+    stats.median = samples[n / 2];
+    stats.p99 = samples[std::min(n - 1, (n * 99) / 100)];
+    stats.mean = sum / double(n);
+    return stats;
+}
+
+double elapsedNs(
+        std::chrono::steady_clock::time_point beg,
+        std::chrono::steady_clock::time_point end) {
+    return double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - beg).count());
+}
+
+// =============================================================================
+// Save Directories
+// =============================================================================
+// Every chunk manager saves edited chunks under its own empty directory,
+// removed again afterwards, so no run loads chunks saved by an earlier one.
+// The atlas benchmark keeps its asset cache in one the same way.
+std::string createSaveDirectory() {
+
+    static int numCreated = 0;
+    std::string name = "rts_benchmark_" +
+        std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) +
+        "_" + std::to_string(numCreated++);
+
+    std::error_code err;
+    std::filesystem::path directory = std::filesystem::temp_directory_path(err);
+    if (err) {
+        directory = ".";
+    }
+    directory /= name;
+    std::filesystem::remove_all(directory, err);
+    return directory.string();
+}
+
+void removeSaveDirectory(const std::string& directory) {
+    std::error_code err;
+    std::filesystem::remove_all(directory, err);
+}
+
+// =============================================================================
+// Kernel Checks
+// =============================================================================
+// The timed fast paths claim to match their reference paths exactly; these
+// run both over the same inputs and report the first difference.  Chunk
+// positions straddle the origin so negative coordinates and the borders
+// between neighboring chunks are covered, plus a few far away ones.
+static const int CHECK_CHUNKS[][2] = {
+    {-2, -2}, {-1, -2}, {0, -2}, {1, -2},
+    {-2, -1}, {-1, -1}, {0, -1}, {1, -1},
+    {-2, 0}, {-1, 0}, {0, 0}, {1, 0},
+    {-2, 1}, {-1, 1}, {0, 1}, {1, 1},
+    {-4097, 3}, {4096, -77}, {-100000, -100000}, {65535, 65536},
+};
+
+bool checkTerrainKernels() {
+
+    TerrainGenerator simd(1234);
+    TerrainGenerator scalar(1234);
+    scalar.setSimd(false);
+
+    TileArray2D expected;
+    TileArray2D actual;
+    for (const int* pos : CHECK_CHUNKS) {
+        Chunk reference(pos[0], pos[1]);
+        Chunk chunk(pos[0], pos[1]);
+        scalar.generate(reference);
+        simd.generate(chunk);
+        reference.getData(expected);
+        chunk.getData(actual);
+
+        for (int y = 0; y < CHUNK_TILES_Y; y++) {
+            for (int x = 0; x < CHUNK_TILES_X; x++) {
+                if (actual[y][x] != expected[y][x]) {
+                    std::printf("FAILED terrain.generate %s: chunk (%d, %d) tile (%d, %d) is %d, scalar %d\n",
+                        TerrainGenerator::getKernelName(), pos[0], pos[1], x, y, actual[y][x], expected[y][x]);
+                    return false;
+                }
+            }
+        }
+    }
+
+    std::printf("%-28s %s matches scalar over %zu chunks\n", "check terrain.generate",
+        TerrainGenerator::getKernelName(), sizeof(CHECK_CHUNKS) / sizeof(CHECK_CHUNKS[0]));
+    return true;
+}
+
+bool checkAutotileVariants(const char* name, const PaddedTileArray2D& padded) {
+
+    TileArray2D expected;
+    TileArray2D actual;
+    Autotiler::computeVariants(padded, expected, false);
+    Autotiler::computeVariants(padded, actual);
+
+    for (int y = 0; y < CHUNK_TILES_Y; y++) {
+        for (int x = 0; x < CHUNK_TILES_X; x++) {
+            if (actual[y][x] != expected[y][x]) {
+                std::printf("FAILED autotile.chunk %s: %s tile (%d, %d) is %d, scalar %d\n",
+                    Autotiler::getKernelName(), name, x, y, actual[y][x], expected[y][x]);
+                return false;
+            }
+        }
+    }
+
+    // edits re-mask a row range from a padded array filled only with the
+    // rows it reads (see ChunkManager::padTiles); the rest is garbage here
+    static const int RANGE_LENGTHS[3] = {1, 2, 5};
+    for (int minY = 0; minY < CHUNK_TILES_Y; minY += 3) {
+        for (int length : RANGE_LENGTHS) {
+            int maxY = std::min(minY + length - 1, CHUNK_TILES_Y - 1);
+
+            PaddedTileArray2D partial;
+            std::memset(partial, 0xFF, sizeof(partial));
+            std::memcpy(partial[minY], padded[minY], size_t(maxY - minY + 3) * (CHUNK_TILES_X + 2));
+            std::memset(actual, 0xFF, sizeof(actual));
+            Autotiler::computeVariants(partial, actual, minY, maxY);
+
+            for (int y = 0; y < CHUNK_TILES_Y; y++) {
+                for (int x = 0; x < CHUNK_TILES_X; x++) {
+                    std::uint8_t want = (y >= minY && y <= maxY) ? expected[y][x] : std::uint8_t(0xFF);
+                    if (actual[y][x] != want) {
+                        std::printf("FAILED autotile.rows %s: %s rows %d to %d tile (%d, %d) is %d, expected %d\n",
+                            Autotiler::getKernelName(), name, minY, maxY, x, y, actual[y][x], want);
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool checkAutotileKernels() {
+
+    PaddedTileArray2D padded;
+    int numChecked = 0;
+
+    // generated chunks padded with their neighbors' edges, as streamed
+    TerrainGenerator generator(1234);
+    for (const int* pos : CHECK_CHUNKS) {
+        for (int cy = -1; cy <= 1; cy++) {
+            for (int cx = -1; cx <= 1; cx++) {
+                Chunk chunk(pos[0] + cx, pos[1] + cy);
+                generator.generate(chunk);
+
+                // the part of this chunk that lands in the padded array
+                for (int y = 0; y < CHUNK_TILES_Y + 2; y++) {
+                    int ty = y - 1 - cy * CHUNK_TILES_Y;
+                    for (int x = 0; x < CHUNK_TILES_X + 2; x++) {
+                        int tx = x - 1 - cx * CHUNK_TILES_X;
+                        if (tx >= 0 && tx < CHUNK_TILES_X && ty >= 0 && ty < CHUNK_TILES_Y) {
+                            padded[y][x] = chunk.getTile(tx, ty);
+                        }
+                    }
+                }
+            }
+        }
+
+        std::string name = "chunk (" + std::to_string(pos[0]) + ", " + std::to_string(pos[1]) + ")";
+        if (!checkAutotileVariants(name.c_str(), padded)) {
+            return false;
+        }
+        numChecked++;
+    }
+
+    // few distinct ids scattered at random reach every mask
+    unsigned int state = 2024;
+    for (int numIds = 2; numIds <= 4; numIds++) {
+        for (int i = 0; i < 4; i++) {
+            for (int y = 0; y < CHUNK_TILES_Y + 2; y++) {
+                for (int x = 0; x < CHUNK_TILES_X + 2; x++) {
+                    state = state * 1664525u + 1013904223u;
+                    padded[y][x] = std::uint8_t((state >> 16) % numIds);
+                }
+            }
+            std::string name = "random " + std::to_string(numIds) + " ids";
+            if (!checkAutotileVariants(name.c_str(), padded)) {
+                return false;
+            }
+            numChecked++;
+        }
+    }
+
+    std::printf("%-28s %s matches scalar over %d chunks\n", "check autotile.chunk",
+        Autotiler::getKernelName(), numChecked);
+    std::printf("%-28s %s row ranges match whole chunks over %d chunks\n", "check autotile.rows",
+        Autotiler::getKernelName(), numChecked);
+    return true;
+}
+
+bool checkTileRoundTrip(const char* name, const TileArray2D& tiles) {
+
+    TileArray2D decoded;
+    const std::uint8_t* expected = &tiles[0][0];
+    const std::uint8_t* actual = &decoded[0][0];
+
+    // palette storage loaded in one go and tile by tile
+    TileStorage loaded;
+    TileStorage edited;
+    loaded.load(tiles);
+    for (int i = 0; i < CHUNK_TILES; i++) {
+        edited.set(i, expected[i]);
+    }
+
+    for (int i = 0; i < CHUNK_TILES; i++) {
+        if (loaded.get(i) != expected[i] || edited.get(i) != expected[i]) {
+            std::printf("FAILED tile storage %s: tile %d is %d/%d, expected %d\n",
+                name, i, loaded.get(i), edited.get(i), expected[i]);
+            return false;
+        }
+    }
+
+    loaded.store(decoded);
+    if (std::memcmp(actual, expected, CHUNK_TILES) != 0) {
+        std::printf("FAILED tile storage %s: store() differs from load()\n", name);
+        return false;
+    }
+
+    // region records
+    std::vector<std::uint8_t> record;
+    encodeTilesRLE(tiles, record);
+    std::memset(decoded, 0xff, sizeof(decoded));
+    if (!decodeTilesRLE(record.data(), record.size(), decoded) ||
+            std::memcmp(actual, expected, CHUNK_TILES) != 0) {
+        std::printf("FAILED tile RLE %s: %zu byte record does not decode\n", name, record.size());
+        return false;
+    }
+
+    // a truncated record must be rejected rather than decoded short
+    if (decodeTilesRLE(record.data(), record.size() - 2, decoded)) {
+        std::printf("FAILED tile RLE %s: truncated record decoded\n", name);
+        return false;
+    }
+    return true;
+}
+
+bool checkTileStorage() {
+
+    TileArray2D tiles;
+    std::uint8_t* dst = &tiles[0][0];
+    int numChecked = 0;
+
+    // uniform, then every palette width and raw bytes
+    const int numDistinct[] = {1, 2, 3, 4, 5, 16, 17, 256};
+    for (int n : numDistinct) {
+        for (int i = 0; i < CHUNK_TILES; i++) {
+            dst[i] = std::uint8_t((i * 7 + i / 5) % n + 3);
+        }
+        std::string name = std::to_string(n) + " ids";
+        if (!checkTileRoundTrip(name.c_str(), tiles)) {
+            return false;
+        }
+        numChecked++;
+    }
+
+    // runs longer than one RLE run
+    for (int i = 0; i < CHUNK_TILES; i++) {
+        dst[i] = std::uint8_t(i < 700 ? 9 : 200);
+    }
+    if (!checkTileRoundTrip("long runs", tiles)) {
+        return false;
+    }
+    numChecked++;
+
+    TerrainGenerator generator(1234);
+    for (const int* pos : CHECK_CHUNKS) {
+        Chunk chunk(pos[0], pos[1]);
+        generator.generate(chunk);
+        chunk.getData(tiles);
+        std::string name = "chunk (" + std::to_string(pos[0]) + ", " + std::to_string(pos[1]) + ")";
+        if (!checkTileRoundTrip(name.c_str(), tiles)) {
+            return false;
+        }
+        numChecked++;
+    }
+
+    std::printf("%-28s palette and RLE round trips over %d chunks\n", "check tile storage", numChecked);
+    return true;
+}
+
+// =============================================================================
+// Benchmark Chunk Functions
+// =============================================================================
+template <typename Func>
+void benchmarkChunk(const char* name, Func func) {
+
+    Chunk* chunk = new Chunk();
+    std::vector<double> samples;
+    samples.reserve(BENCHMARK_SAMPLES);
+
+    for (int i = 0; i < BENCHMARK_WARMUP; i++) {
+        func(*chunk, i);
+    }
+
+    size_t allocsBeg = numAllocs;
+    for (int i = 0; i < BENCHMARK_SAMPLES; i++) {
+        auto beg = std::chrono::steady_clock::now();
+        func(*chunk, i);
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(elapsedNs(beg, end));
+    }
+    size_t allocs = numAllocs - allocsBeg;
+
+    Stats stats = computeStats(samples);
+    const double numTiles = CHUNK_TILES_X * CHUNK_TILES_Y;
+
+    std::printf(
+        "%-28s median %9.0f ns  p99 %9.0f ns  %7.2f ns/tile  %10.0f chunks/s  %5.2f allocs/chunk\n",
+        name,
+        stats.median,
+        stats.p99,
+        stats.median / numTiles,
+        1e9 / stats.mean,
+        double(allocs) / BENCHMARK_SAMPLES);
+
+    delete chunk;
+}
+
+// =============================================================================
+// Benchmark Tile Compression
+// =============================================================================
+// Resident and serialized tile bytes over a square of generated terrain.
+void benchmarkCompression(int side) {
+
+    TerrainGenerator generator(0);
+    size_t numChunks = 0;
+    size_t numUniform = 0;
+    size_t residentBytes = 0;
+    size_t rleBytes = 0;
+    size_t bitsHistogram[9] = {};
+
+    TileArray2D tiles;
+    std::vector<std::uint8_t> record;
+
+    for (int y = -side / 2; y < side - side / 2; y++) {
+        for (int x = -side / 2; x < side - side / 2; x++) {
+            Chunk chunk(x, y);
+            generator.generate(chunk);
+
+            const TileStorage& storage = chunk.getStorage();
+            residentBytes += storage.getMemoryUsage();
+            bitsHistogram[storage.getBitsPerTile()]++;
+            if (storage.isUniform()) {
+                numUniform++;
+            }
+
+            chunk.getData(tiles);
+            encodeTilesRLE(tiles, record);
+            rleBytes += record.size();
+            numChunks++;
+        }
+    }
+
+    double raw = double(sizeof(TileArray2D));
+    double resident = double(residentBytes) / double(numChunks);
+    double rle = double(rleBytes) / double(numChunks);
+
+    std::printf(
+        "%-28s resident %6.0f bytes/chunk (%5.1fx)  rle %6.0f bytes/chunk (%5.1fx)  uniform %zu/%zu  bits 0/1/2/4/8: %zu/%zu/%zu/%zu/%zu\n",
+        ("tiles.compress " + std::to_string(side) + "x" + std::to_string(side)).c_str(),
+        resident,
+        raw / resident,
+        rle,
+        raw / rle,
+        numUniform,
+        numChunks,
+        bitsHistogram[0],
+        bitsHistogram[1],
+        bitsHistogram[2],
+        bitsHistogram[4],
+        bitsHistogram[8]);
+}
+
+// =============================================================================
+// Benchmark World
+// =============================================================================
+// A chunk manager whose camera sees exactly radius chunks around the origin
+// chunk, with those chunks loaded and meshed, saving under its own fresh
+// directory.  pickTile() draws tiles of the drawn chunks from a fixed seed
+// so runs are repeatable; pickWalkable() skips unwalkable ones.
+struct BenchmarkWorld {
+    BenchmarkWorld(int radius, unsigned int seed, vec2f_t cameraVel = {{0.0f, 0.0f}});
+    ~BenchmarkWorld();
+    BenchmarkWorld(const BenchmarkWorld&) = delete;
+    BenchmarkWorld& operator=(const BenchmarkWorld&) = delete;
+    unsigned int next();
+    vec2i_t pickTile();
+    vec2i_t pickWalkable();
+
+    Camera camera;
+    std::string saveDirectory;
+    ChunkManager* manager = nullptr;
+    int tilesMin = 0;
+    int tilesSpan = 0;
+    unsigned int state = 0;
+};
+
+BenchmarkWorld::BenchmarkWorld(int radius, unsigned int seed, vec2f_t cameraVel) {
+
+    int viewPixels = 2 * radius * CHUNK_PIXELS_X;
+    camera.initOrthographic(viewPixels, viewPixels);
+    camera.initView(0.0f, 0.0f, 0.0f);
+
+    saveDirectory = createSaveDirectory();
+    manager = new ChunkManager(saveDirectory);
+    manager->init({{float(viewPixels), float(viewPixels)}});
+    manager->update(camera, cameraVel);
+    manager->flush();
+
+    tilesMin = -radius * CHUNK_TILES_X;
+    tilesSpan = (2 * radius + 1) * CHUNK_TILES_X;
+    state = seed;
+}
+
+BenchmarkWorld::~BenchmarkWorld() {
+    delete manager;
+    removeSaveDirectory(saveDirectory);
+}
+
+unsigned int BenchmarkWorld::next() {
+    state = state * 1664525u + 1013904223u;
+    return state;
+}
+
+vec2i_t BenchmarkWorld::pickTile() {
+    vec2i_t tile;
+    tile.x = tilesMin + int((next() >> 8) % unsigned(tilesSpan));
+    tile.y = tilesMin + int((next() >> 8) % unsigned(tilesSpan));
+    return tile;
+}
+
+vec2i_t BenchmarkWorld::pickWalkable() {
+    vec2i_t tile;
+    do {
+        tile = pickTile();
+    } while (!manager->getPathfinder().isWalkable(tile.x, tile.y));
+    return tile;
+}
+
+// =============================================================================
+// Benchmark Chunk Manager Camera Pan
+// =============================================================================
+// Frame timings are the main thread cost of update() and render(); chunks/s
+// covers the whole pan including waiting for the workers to finish.  The
+// camera sees exactly radius chunks around the center chunk.
+void benchmarkPan(int radius, int stepX, int stepY, int numSteps) {
+
+    // load the initial activation area
+    size_t bytesBeg = numLiveBytes;
+    vec2f_t cameraVel = {{float(stepX * CHUNK_PIXELS_X), float(stepY * CHUNK_PIXELS_Y)}};
+    BenchmarkWorld world(radius, 1u, cameraVel);
+    Camera& camera = world.camera;
+    ChunkManager* manager = world.manager;
+
+    std::vector<double> samples;
+    samples.reserve(numSteps);
+
+    size_t allocsBeg = numAllocs;
+    size_t loadedBeg = manager->getNumLoaded();
+    auto panBeg = std::chrono::steady_clock::now();
+    for (int i = 0; i < numSteps; i++) {
+        camera.moveView(camera.pos.x + cameraVel.x, camera.pos.y + cameraVel.y);
+
+        auto beg = std::chrono::steady_clock::now();
+        manager->update(camera, cameraVel);
+        manager->render(camera);
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(elapsedNs(beg, end));
+    }
+    manager->flush();
+    manager->render(camera);
+    auto panEnd = std::chrono::steady_clock::now();
+    size_t allocs = numAllocs - allocsBeg;
+
+    // heap bytes per resident chunk, including the meshes of drawn chunks
+    double numChunks = double(manager->getNumChunks());
+    double bytesPerChunk = double(numLiveBytes - bytesBeg) / numChunks;
+
+    // chunks that left the load area before a worker reached them are
+    // never loaded, so count what was actually received
+    Stats stats = computeStats(samples);
+    double numLoads = double(manager->getNumLoaded() - loadedBeg);
+
+    std::string name = std::string(stepY == 0 ? "pan-x" : "pan-diag") +
+        " r=" + std::to_string(radius);
+
+    std::printf(
+        "%-28s median %9.3f ms  p99 %9.3f ms  %10.0f chunks/s  %5.2f allocs/chunk  %8.0f bytes/chunk  %zu/%zu drawn\n",
+        name.c_str(),
+        stats.median / 1e6,
+        stats.p99 / 1e6,
+        numLoads / (elapsedNs(panBeg, panEnd) / 1e9),
+        double(allocs) / numLoads,
+        bytesPerChunk,
+        size_t(manager->getNumDrawn()),
+        manager->getNumChunks());
+}
+
+// =============================================================================
+// Benchmark Asset Startup
+// =============================================================================
+// Chunk atlas initialization with the asset cache missing (decode the image)
+// and present (map the decoded layers).
+void benchmarkAtlas(int numRuns) {
+
+    std::vector<double> cold;
+    std::vector<double> warm;
+    std::string cacheDirectory = createSaveDirectory();
+
+    for (int i = 0; i < numRuns; i++) {
+        removeSaveDirectory(cacheDirectory);
+
+        auto beg = std::chrono::steady_clock::now();
+        {
+            ChunkAtlas atlas;
+            atlas.init(cacheDirectory);
+        }
+        auto mid = std::chrono::steady_clock::now();
+        {
+            ChunkAtlas atlas;
+            atlas.init(cacheDirectory);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        cold.push_back(elapsedNs(beg, mid));
+        warm.push_back(elapsedNs(mid, end));
+    }
+    removeSaveDirectory(cacheDirectory);
+
+    Stats coldStats = computeStats(cold);
+    Stats warmStats = computeStats(warm);
+    std::printf(
+        "%-28s cold %9.3f ms  cached %9.3f ms  (%5.1fx)\n",
+        "asset.atlas",
+        coldStats.median / 1e6,
+        warmStats.median / 1e6,
+        coldStats.median / warmStats.median);
+}
+
+// =============================================================================
+// Benchmark Tile Edits
+// =============================================================================
+// Frame timings cover editsPerFrame scattered setTile() calls plus the
+// update() that re-masks and uploads them.
+void benchmarkEdits(int radius, int editsPerFrame, int numFrames) {
+
+    // edits land anywhere in the drawn chunks
+    BenchmarkWorld world(radius, 12345u);
+    ChunkManager* manager = world.manager;
+
+    std::vector<double> samples;
+    samples.reserve(numFrames);
+
+    size_t allocsBeg = numAllocs;
+    for (int i = 0; i < numFrames; i++) {
+        auto beg = std::chrono::steady_clock::now();
+        for (int e = 0; e < editsPerFrame; e++) {
+            vec2i_t tile = world.pickTile();
+            manager->setTile(tile.x, tile.y, std::uint8_t((world.state >> 4) & 3));
+        }
+        manager->update(world.camera);
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(elapsedNs(beg, end));
+    }
+    size_t allocs = numAllocs - allocsBeg;
+
+    Stats stats = computeStats(samples);
+    std::string name = "edit.setTile r=" + std::to_string(radius) +
+        " n=" + std::to_string(editsPerFrame);
+
+    std::printf(
+        "%-28s median %9.3f ms  p99 %9.3f ms  %7.0f ns/edit  %5.2f allocs/frame\n",
+        name.c_str(),
+        stats.median / 1e6,
+        stats.p99 / 1e6,
+        stats.median / double(editsPerFrame),
+        double(allocs) / double(numFrames));
+}
+
+// =============================================================================
+// Benchmark Paths
+// =============================================================================
+// Paths between random walkable tiles of the resident chunks, with the
+// cluster caches warm, then the cost of rebuilding after an edit.  Returns
+// false if the edit rebuilt no cluster.
+bool benchmarkPaths(int radius, int numPaths) {
+
+    // endpoints anywhere in the drawn chunks
+    BenchmarkWorld world(radius, 777u);
+    ChunkManager* manager = world.manager;
+    Pathfinder& pathfinder = manager->getPathfinder();
+
+    // build every cluster up front so queries only time searches
+    while (pathfinder.rebuildNext()) {}
+
+    std::vector<vec2i_t> path;
+
+    std::vector<double> samples;
+    samples.reserve(numPaths);
+    int numFound = 0;
+    size_t numSteps = 0;
+    for (int i = 0; i < numPaths; i++) {
+        vec2i_t start = world.pickWalkable();
+        vec2i_t goal = world.pickWalkable();
+        auto beg = std::chrono::steady_clock::now();
+        numFound += pathfinder.findPath(start, goal, path);
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(elapsedNs(beg, end));
+        numSteps += path.size();
+    }
+
+    Stats stats = computeStats(samples);
+    std::string name = "path.hpa r=" + std::to_string(radius);
+    std::printf(
+        "%-28s median %9.3f ms  p99 %9.3f ms  %10.0f paths/s  %3d%% found  %5.0f tiles/path\n",
+        name.c_str(),
+        stats.median / 1e6,
+        stats.p99 / 1e6,
+        1e9 / stats.mean,
+        100 * numFound / numPaths,
+        double(numSteps) / std::max(1, numFound));
+
+    // walling off a walkable tile dirties its cluster; a query starting in
+    // that chunk has to rebuild it
+    size_t rebuiltBeg = pathfinder.getNumRebuilt();
+    vec2i_t edited = world.pickWalkable();
+    manager->setTile(edited.x, edited.y, TILE_WATER);
+    manager->update(world.camera);
+
+    int baseX = getChunkCoordOfTileX(edited.x) * CHUNK_TILES_X;
+    int baseY = getChunkCoordOfTileY(edited.y) * CHUNK_TILES_Y;
+    vec2i_t start;
+    do {
+        start.x = baseX + int((world.next() >> 8) % CHUNK_TILES_X);
+        start.y = baseY + int((world.next() >> 8) % CHUNK_TILES_Y);
+    } while (!pathfinder.isWalkable(start.x, start.y));
+    vec2i_t goal = world.pickWalkable();
+
+    auto beg = std::chrono::steady_clock::now();
+    pathfinder.findPath(start, goal, path);
+    auto end = std::chrono::steady_clock::now();
+    size_t numRebuilt = pathfinder.getNumRebuilt() - rebuiltBeg;
+    std::printf("%-28s total  %9.3f ms  %zu clusters rebuilt\n",
+        "path.hpa after edit",
+        elapsedNs(beg, end) / 1e6,
+        numRebuilt);
+
+    if (numRebuilt == 0) {
+        std::printf("FAILED path.hpa after edit: tile (%d, %d) rebuilt no cluster\n", edited.x, edited.y);
+        return false;
+    }
+    return true;
+}
+
+// =============================================================================
+// Benchmark Flow Fields
+// =============================================================================
+// Flow fields toward random walkable goals in the resident chunks, each
+// computed from scratch, then the same goals again from the cache.
+void benchmarkFlowFields(int radius, int numGoals) {
+
+    BenchmarkWorld world(radius, 4242u);
+    FlowFieldCache& flowFields = world.manager->getFlowFields();
+
+    std::vector<vec2i_t> goals;
+    while (int(goals.size()) < numGoals) {
+        goals.push_back(world.pickWalkable());
+    }
+
+    std::vector<double> samples;
+    std::vector<double> cachedSamples;
+    for (vec2i_t goal : goals) {
+        auto beg = std::chrono::steady_clock::now();
+        flowFields.get(goal);
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(elapsedNs(beg, end));
+    }
+    for (vec2i_t goal : goals) {
+        auto beg = std::chrono::steady_clock::now();
+        flowFields.get(goal);
+        auto end = std::chrono::steady_clock::now();
+        cachedSamples.push_back(elapsedNs(beg, end));
+    }
+
+    Stats stats = computeStats(samples);
+    Stats cached = computeStats(cachedSamples);
+    std::string name = "path.flow r=" + std::to_string(radius);
+    std::printf(
+        "%-28s median %9.3f ms  p99 %9.3f ms  cached %7.3f ms  %zu computed\n",
+        name.c_str(),
+        stats.median / 1e6,
+        stats.p99 / 1e6,
+        cached.median / 1e6,
+        flowFields.getNumComputed());
+}
+
+// =============================================================================
+// Benchmark Path Service
+// =============================================================================
+// An army order: numUnits requests from random tiles of the resident chunks
+// to one goal, submitted at once and delivered over real 30 Hz ticks under
+// the default budget, after the replicas had time to build their clusters.
+void benchmarkPathService(int radius, int numUnits) {
+
+    BenchmarkWorld world(radius, 31337u);
+    Pathfinder& pathfinder = world.manager->getPathfinder();
+
+    const auto tick = std::chrono::microseconds(1000000 / 30);
+    // a generous budget while the replicas build every cluster
+    PathService* service = new PathService();
+    service->setBudget(1000.0);
+    service->sync(pathfinder);
+    for (int i = 0; i < 60; i++) {
+        std::this_thread::sleep_for(tick);
+        service->beginTick();
+    }
+    service->setBudget(PATH_SERVICE_BUDGET_MS);
+    service->beginTick();
+
+    vec2i_t goal = world.pickWalkable();
+    std::vector<vec2i_t> starts;
+    for (int i = 0; i < numUnits; i++) {
+        starts.push_back(world.pickWalkable());
+    }
+
+    std::vector<PathHandle> handles;
+    auto beg = std::chrono::steady_clock::now();
+    for (vec2i_t start : starts) {
+        handles.push_back(service->request(start, goal));
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    size_t searchedBeg = service->getNumSearched();
+    int numTicks = 0;
+    double maxSpentMs = 0.0;
+    size_t numPending = handles.size();
+    while (numPending > 0 && numTicks < 3000) {
+        std::this_thread::sleep_for(tick);
+        service->beginTick();
+        maxSpentMs = std::max(maxSpentMs, service->getSpentMs());
+        numTicks++;
+
+        numPending = 0;
+        for (PathHandle handle : handles) {
+            numPending += service->getStatus(handle) == PATH_STATUS_PENDING;
+        }
+    }
+
+    std::string name = "path.service n=" + std::to_string(numUnits);
+    std::printf("%-28s submit %9.3f ms  %5zu searches  %4d ticks  max %6.3f ms/tick\n",
+        name.c_str(),
+        elapsedNs(beg, end) / 1e6,
+        service->getNumSearched() - searchedBeg,
+        numTicks,
+        maxSpentMs);
+
+    delete service;
+}
+
+// =============================================================================
+// Benchmark Units
+// =============================================================================
+// One simulation tick of the unit systems over numUnits units, plus churn:
+// destroying and recreating a tenth of them.
+void benchmarkUnits(int numUnits, int numTicks) {
+
+    World* world = new World();
+    UnitSystems::spawn(*world, numUnits, 4096.0f, 64.0f, 0);
+    const float dt = 1.0f / 30.0f;
+
+    std::vector<double> samples;
+    samples.reserve(numTicks);
+
+    size_t allocsBeg = numAllocs;
+    for (int i = 0; i < numTicks; i++) {
+        auto beg = std::chrono::steady_clock::now();
+        UnitSystems::move(*world, dt);
+        UnitSystems::confine(*world, 4096.0f);
+        UnitSystems::updateChunkCells(*world);
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(elapsedNs(beg, end));
+    }
+    size_t allocs = numAllocs - allocsBeg;
+
+    Stats stats = computeStats(samples);
+    std::string name = "units.tick n=" + std::to_string(numUnits);
+
+    std::printf(
+        "%-28s median %9.3f ms  p99 %9.3f ms  %7.2f ns/unit  %5.2f allocs/tick\n",
+        name.c_str(),
+        stats.median / 1e6,
+        stats.p99 / 1e6,
+        stats.median / double(numUnits),
+        double(allocs) / double(numTicks));
+
+    // collect handles, then churn a tenth of them
+    std::vector<Entity> entities;
+    world->forEach<Position>([&entities](int count, const Entity* e, Position*) {
+        entities.insert(entities.end(), e, e + count);
+    });
+
+    auto beg = std::chrono::steady_clock::now();
+    int numChurned = 0;
+    for (size_t i = 0; i < entities.size(); i += 10) {
+        world->destroy(entities[i]);
+        numChurned++;
+    }
+    UnitSystems::spawn(*world, numChurned, 4096.0f, 64.0f, 1);
+    auto end = std::chrono::steady_clock::now();
+
+    name = "units.churn n=" + std::to_string(numChurned);
+    std::printf("%-28s total  %9.3f ms  %7.2f ns/unit\n",
+        name.c_str(),
+        elapsedNs(beg, end) / 1e6,
+        elapsedNs(beg, end) / double(2 * numChurned));
+
+    delete world;
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+int main(int argc, char* argv[]) {
+
+    int numSteps = BENCHMARK_PAN_STEPS;
+    if (argc > 1) {
+        numSteps = std::max(1, std::atoi(argv[1]));
+    }
+
+    std::printf("chunk pipeline benchmark (headless)\n");
+    std::printf("sizeof(Chunk) = %zu bytes\n", sizeof(Chunk));
+    std::printf("sizeof(ChunkMesh) = %zu bytes + %zu bytes GPU slot\n\n",
+        sizeof(ChunkMesh), CHUNK_BUFFER_SIZE);
+
+    if (!checkTerrainKernels() || !checkAutotileKernels() || !checkTileStorage()) {
+        return 1;
+    }
+    std::printf("\n");
+
+    // meshes no longer build vertices on the CPU, so tile generation is the
+    // only per-chunk CPU stage left to time
+    benchmarkChunk("chunk.construct", [](Chunk& chunk, int i) {
+        chunk = Chunk(i, -i);
+    });
+
+    TerrainGenerator generator(0);
+    std::string terrainName = std::string("terrain.generate ") + TerrainGenerator::getKernelName();
+
+    benchmarkChunk(terrainName.c_str(), [&generator](Chunk& chunk, int i) {
+        chunk = Chunk(i, -i);
+        generator.generate(chunk);
+    });
+
+    TerrainGenerator generatorScalar(0);
+    generatorScalar.setSimd(false);
+
+    benchmarkChunk("terrain.generate scalar", [&generatorScalar](Chunk& chunk, int i) {
+        chunk = Chunk(i, -i);
+        generatorScalar.generate(chunk);
+    });
+
+    TileArray2D tiles;
+    benchmarkChunk("chunk.getData", [&generator, &tiles](Chunk& chunk, int i) {
+        if (i < BENCHMARK_WARMUP) {
+            chunk = Chunk(i, -i);
+            generator.generate(chunk);
+        }
+        chunk.getData(tiles);
+    });
+
+    benchmarkChunk("chunk.setTile", [](Chunk& chunk, int i) {
+        for (int y = 0; y < CHUNK_TILES_Y; y++) {
+            for (int x = 0; x < CHUNK_TILES_X; x++) {
+                chunk.setTile(x, y, std::uint8_t((x + y + i) & 3));
+            }
+        }
+    });
+
+    // autotile masks of one generated chunk, edges repeated as padding
+    Chunk terrain(3, -5);
+    generator.generate(terrain);
+    terrain.getData(tiles);
+
+    PaddedTileArray2D padded;
+    for (int y = 0; y < CHUNK_TILES_Y + 2; y++) {
+        int ty = std::min(std::max(y - 1, 0), CHUNK_TILES_Y - 1);
+        for (int x = 0; x < CHUNK_TILES_X + 2; x++) {
+            padded[y][x] = tiles[ty][std::min(std::max(x - 1, 0), CHUNK_TILES_X - 1)];
+        }
+    }
+
+    TileArray2D variants;
+    std::string autotileName = std::string("autotile.chunk ") + Autotiler::getKernelName();
+
+    benchmarkChunk(autotileName.c_str(), [&padded, &variants](Chunk&, int) {
+        Autotiler::computeVariants(padded, variants);
+    });
+
+    benchmarkChunk("autotile.chunk scalar", [&padded, &variants](Chunk&, int) {
+        Autotiler::computeVariants(padded, variants, false);
+    });
+
+    std::printf("\n");
+
+    benchmarkCompression(64);
+
+    std::printf("\n");
+
+    benchmarkAtlas(20);
+
+    std::printf("\n");
+
+    benchmarkEdits(4, 10, numSteps);
+    benchmarkEdits(4, 1000, numSteps);
+
+    std::printf("\n");
+
+    benchmarkUnits(50000, numSteps);
+
+    std::printf("\n");
+
+    if (!benchmarkPaths(4, 1000) || !benchmarkPaths(8, 1000)) {
+        return 1;
+    }
+    benchmarkFlowFields(8, FLOW_CACHE_FIELDS);
+    benchmarkPathService(8, 5000);
+
+    std::printf("\n");
+
+    const int radii[] = {1, 2, 4, 8, 16};
+    for (int r : radii) {
+        benchmarkPan(r, 1, 0, numSteps);
+    }
+    for (int r : radii) {
+        benchmarkPan(r, 1, 1, numSteps);
+    }
+
+    return 0;
+}
@@ -9,9 +9,14 @@
 #include <SDL.h>
 
 // STL includes
+#include <algorithm>
 #include <vector>
 #include <iostream>
 
+// definitions
+#define CAMERA_ZOOM_MIN 0.1f
+#define CAMERA_ZOOM_MAX 2.0f
+
 // =============================================================================
 // Camera Class
 // =============================================================================
@@ -24,6 +29,7 @@ class Camera {
         void moveView(float x, float y);
         void moveView(float x, float y, float z);
         void zoomView(const float zoom);
+        void getViewBounds(vec2f_t& min, vec2f_t& max) const;
 
     public:
         float zoom;
@@ -164,11 +170,11 @@ void Camera::moveView(float x, float y, float z) {
 // =============================================================================
 void Camera::zoomView(const float zoom) {
 
-    if (zoom < 0.1f) {
-        this->zoom = 0.1f;
+    if (zoom < CAMERA_ZOOM_MIN) {
+        this->zoom = CAMERA_ZOOM_MIN;
     }
-    else if (zoom > 2.0f) {
-        this->zoom = 2.0f;
+    else if (zoom > CAMERA_ZOOM_MAX) {
+        this->zoom = CAMERA_ZOOM_MAX;
     }
     else {
         this->zoom = zoom;
@@ -178,6 +184,30 @@ void Camera::zoomView(const float zoom) {
     viewMat.m11 = this->zoom;
 }
 
+// =============================================================================
+// Get View Bounds
+// =============================================================================
+// World space rectangle visible through the orthographic projection, found
+// by inverting projMat * viewMat at the clip space corners.  Neither matrix
+// rotates, so only the diagonal scale and the translation matter.
+void Camera::getViewBounds(vec2f_t& min, vec2f_t& max) const {
+
+    float scaleX = projMat.m00 * viewMat.m00;
+    float scaleY = projMat.m11 * viewMat.m11;
+    float transX = projMat.m00 * viewMat.m30 + projMat.m30;
+    float transY = projMat.m11 * viewMat.m31 + projMat.m31;
+
+    float x0 = (-1.0f - transX) / scaleX;
+    float x1 = ( 1.0f - transX) / scaleX;
+    float y0 = (-1.0f - transY) / scaleY;
+    float y1 = ( 1.0f - transY) / scaleY;
+
+    min.x = std::min(x0, x1);
+    max.x = std::max(x0, x1);
+    min.y = std::min(y0, y1);
+    max.y = std::max(y0, y1);
+}
+
 #endif // CAMERA_H
 
 // generate c++ code to render a triangle in opengl
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define CHUNK_ATLAS_H
 
 // local includes
+#include "asset_cache.h"
+#include "mapped_file.h"
 
 /// third party includes
 #include <GL/glew.h>
@@ -10,71 +12,218 @@
 #include "stb_image.h"
 
 // STL includes
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <vector>
 
 // definitions
 #define CHUNK_ATLAS_TILE_PIXELS_U 16
 #define CHUNK_ATLAS_TILE_PIXELS_V 16
+#define CHUNK_ATLAS_CACHE_NAME "chunk_atlas"
+#define CHUNK_ATLAS_MIP_LEVELS 5 // 16x16 down to 1x1
+#define CHUNK_ATLAS_MISSING_COLOR 0xFFFF00FFu // opaque magenta, RGBA8 little endian
+#ifndef CHUNK_ATLAS_FILEPATH
 #define CHUNK_ATLAS_FILEPATH "D:/_projects/rts-engine/resources/images/terrain16.png"
+#endif
+
+static_assert((1 << (CHUNK_ATLAS_MIP_LEVELS - 1)) == CHUNK_ATLAS_TILE_PIXELS_U &&
+              CHUNK_ATLAS_TILE_PIXELS_U == CHUNK_ATLAS_TILE_PIXELS_V,
+              "mip chain must end at one texel per tile");
 
 // =============================================================================
 // ChunkAtlas Class
 // =============================================================================
+// Tile textures as a GL_TEXTURE_2D_ARRAY of RGBA8 layers, one per cell of
+// the atlas image in row-major order, so a tile id is its layer index.  Each
+// layer has its own mip chain and clamps at its edges, so minified tiles
+// never sample their neighbors in the image.  The decoded layers are kept in
+// the asset cache, so the image is only decoded again when it changes.
 class ChunkAtlas {
     public:
         ChunkAtlas() {};
-        void init();
+        ~ChunkAtlas();
+        ChunkAtlas(const ChunkAtlas&) = delete;
+        ChunkAtlas& operator=(const ChunkAtlas&) = delete;
+        void init(const std::string& cacheDirectory = ASSET_CACHE_DIRECTORY);
         GLuint getTextureId() { return textureId; };
-        int getNumTilesU() { return numTilesU; };
-        int getNumTilesV() { return numTilesV; };
-        float getStepU() { return stepU; };
-        float getStepV() { return stepV; };
+        int getNumLayers() const { return numLayers; };
+        std::uint32_t getTileColor(int tile) const;
 
     private:
-        int numChannels;
-        int numPixelsU;
-        int numPixelsV;
-        int numTilesU;
-        int numTilesV;
-        float stepU;
-        float stepV;
+        void decodeLayers(const std::uint8_t* image, size_t size, std::vector<std::uint32_t>& layers);
+        void computeTileColors(const std::uint32_t* texels);
+
+        int numLayers = 0;
         GLuint textureId = 0;
+        std::vector<std::uint32_t> tileColors; // average RGBA8 of each layer
 };
 
+// =============================================================================
+// Destruct ChunkAtlas
+// =============================================================================
+ChunkAtlas::~ChunkAtlas() {
+#ifndef RTS_HEADLESS
+    if (textureId != 0) {
+        glDeleteTextures(1, &textureId);
+    }
+#endif
+}
+
 // =============================================================================
 // Initialize
 // =============================================================================
-void ChunkAtlas::init() {
+void ChunkAtlas::init(const std::string& cacheDirectory) {
+
+    MappedFile source;
+    bool hasSource = source.open(CHUNK_ATLAS_FILEPATH);
+    if (!hasSource) {
+        std::cout << "ERROR: chunk atlas could not be loaded from " << CHUNK_ATLAS_FILEPATH << std::endl;
+    }
+
+    // the layers depend on the image and on how it is cut into cells
+    const std::uint32_t layout[2] = {CHUNK_ATLAS_TILE_PIXELS_U, CHUNK_ATLAS_TILE_PIXELS_V};
+    std::uint64_t key = AssetCache::hash(layout, sizeof(layout));
+    if (hasSource) {
+        key = AssetCache::hash(source.getData(), source.getSize(), key);
+    }
 
-    GLubyte* pixels = stbi_load(
-        CHUNK_ATLAS_FILEPATH,
-        &numPixelsU,
-        &numPixelsV,
-        &numChannels,
-        0);
+    // blob: layer count, padding, then every layer's texels
+    AssetCache cache(cacheDirectory);
+    AssetBlob blob;
+    std::vector<std::uint32_t> decoded;
+    const std::uint32_t* texels = nullptr;
+    const int layerTexels = CHUNK_ATLAS_TILE_PIXELS_U * CHUNK_ATLAS_TILE_PIXELS_V;
 
-    numTilesU = numPixelsU / CHUNK_ATLAS_TILE_PIXELS_U;
-    numTilesV = numPixelsV / CHUNK_ATLAS_TILE_PIXELS_V;
-    stepU = 1.0f / float(numTilesU);
-    stepV = 1.0f / float(numTilesV);
+    if (hasSource && cache.load(CHUNK_ATLAS_CACHE_NAME, key, blob) && blob.getSize() >= 2 * sizeof(std::uint32_t)) {
+        const std::uint32_t* words = (const std::uint32_t*)blob.getData();
+        numLayers = int(words[0]);
+        if (blob.getSize() == (2 + size_t(numLayers) * layerTexels) * sizeof(std::uint32_t)) {
+            texels = words + 2;
+        }
+    }
 
+    if (texels == nullptr) {
+        decodeLayers(hasSource ? source.getData() : nullptr, source.getSize(), decoded);
+        numLayers = int(decoded[0]);
+        texels = decoded.data() + 2;
+        if (hasSource) {
+            cache.store(CHUNK_ATLAS_CACHE_NAME, key, decoded.data(), decoded.size() * sizeof(std::uint32_t));
+        }
+    }
+
+    computeTileColors(texels);
+
+#ifndef RTS_HEADLESS
     glGenTextures(1, &textureId);
-    glBindTexture(GL_TEXTURE_2D, textureId);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(
-        GL_TEXTURE_2D,
-        0,
-        GL_RGBA32F,
-        numPixelsU,
-        numPixelsV,
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureId);
+    glTexStorage3D(
+        GL_TEXTURE_2D_ARRAY,
+        CHUNK_ATLAS_MIP_LEVELS,
+        GL_RGBA8,
+        CHUNK_ATLAS_TILE_PIXELS_U,
+        CHUNK_ATLAS_TILE_PIXELS_V,
+        numLayers);
+    glTexSubImage3D(
+        GL_TEXTURE_2D_ARRAY,
         0,
+        0, 0, 0,
+        CHUNK_ATLAS_TILE_PIXELS_U,
+        CHUNK_ATLAS_TILE_PIXELS_V,
+        numLayers,
         GL_RGBA,
         GL_UNSIGNED_BYTE,
-        pixels);
-    glBindTexture(GL_TEXTURE_2D, 0);
+        texels);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+    // texels stay crisp up close and average out when zoomed away
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+#endif
+}
+
+// =============================================================================
+// Decode Layers
+// =============================================================================
+// Decodes the atlas image and cuts it into one contiguous layer per cell,
+// laid out as the cache blob: layer count, padding, then the texels.
+void ChunkAtlas::decodeLayers(const std::uint8_t* image, size_t size, std::vector<std::uint32_t>& layers) {
+
+    // always expand to four channels so layers are plain RGBA8
+    int numPixelsU = 0;
+    int numPixelsV = 0;
+    int numChannels = 0;
+    GLubyte* pixels = nullptr;
+    if (image != nullptr) {
+        pixels = stbi_load_from_memory(image, int(size), &numPixelsU, &numPixelsV, &numChannels, 4);
+        if (pixels == nullptr) {
+            std::cout << "ERROR: chunk atlas could not be decoded from " << CHUNK_ATLAS_FILEPATH << std::endl;
+            numPixelsU = 0;
+            numPixelsV = 0;
+        }
+    }
+
+    int numTilesU = numPixelsU / CHUNK_ATLAS_TILE_PIXELS_U;
+    int numTilesV = numPixelsV / CHUNK_ATLAS_TILE_PIXELS_V;
+    const int layerTexels = CHUNK_ATLAS_TILE_PIXELS_U * CHUNK_ATLAS_TILE_PIXELS_V;
+
+    // a single missing layer keeps the texture valid without an image
+    int count = std::max(1, numTilesU * numTilesV);
+    layers.assign(2 + size_t(count) * layerTexels, CHUNK_ATLAS_MISSING_COLOR);
+    layers[0] = std::uint32_t(count);
+    layers[1] = 0;
+
+    // copy every cell into its own contiguous layer
+    for (int v = 0; v < numTilesV; v++) {
+        for (int u = 0; u < numTilesU; u++) {
+            std::uint32_t* layer = layers.data() + 2 + size_t(v * numTilesU + u) * layerTexels;
+            for (int py = 0; py < CHUNK_ATLAS_TILE_PIXELS_V; py++) {
+                const GLubyte* row = pixels +
+                    (size_t(v * CHUNK_ATLAS_TILE_PIXELS_V + py) * numPixelsU + u * CHUNK_ATLAS_TILE_PIXELS_U) * 4;
+                std::memcpy(layer + py * CHUNK_ATLAS_TILE_PIXELS_U, row, CHUNK_ATLAS_TILE_PIXELS_U * 4);
+            }
+        }
+    }
     stbi_image_free(pixels);
 }
 
+// =============================================================================
+// Compute Tile Colors
+// =============================================================================
+// Averages every layer for the level of detail renderer, which draws a tile
+// as a single texel.
+void ChunkAtlas::computeTileColors(const std::uint32_t* texels) {
+
+    const int layerTexels = CHUNK_ATLAS_TILE_PIXELS_U * CHUNK_ATLAS_TILE_PIXELS_V;
+    tileColors.assign(size_t(numLayers), CHUNK_ATLAS_MISSING_COLOR);
+
+    for (int l = 0; l < numLayers; l++) {
+        std::uint32_t sum[4] = {0, 0, 0, 0};
+        const std::uint32_t* layer = texels + size_t(l) * layerTexels;
+        for (int i = 0; i < layerTexels; i++) {
+            for (int c = 0; c < 4; c++) {
+                sum[c] += (layer[i] >> (c * 8)) & 0xFFu;
+            }
+        }
+
+        const std::uint32_t n = layerTexels;
+        tileColors[l] = (sum[0] / n) | ((sum[1] / n) << 8) | ((sum[2] / n) << 16) | ((sum[3] / n) << 24);
+    }
+}
+
+// =============================================================================
+// Get Tile Color
+// =============================================================================
+std::uint32_t ChunkAtlas::getTileColor(int tile) const {
+    if (tile < 0 || size_t(tile) >= tileColors.size()) {
+        return CHUNK_ATLAS_MISSING_COLOR;
+    }
+    return tileColors[tile];
+}
+
 #endif // CHUNK_ATLAS_H
\ No newline at end of file
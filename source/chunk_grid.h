@@ -0,0 +1,180 @@
+#ifndef CHUNK_GRID_H
+#define CHUNK_GRID_H
+
+// local includes
+#include "types.h"
+
+// STL includes
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// =============================================================================
+// ChunkGrid Class
+// =============================================================================
+// Fixed capacity toroidal grid keyed by chunk position.  A chunk lives in the
+// slot (x mod width, y mod height), so any window no larger than the grid
+// maps every position to its own slot and lookups are a masked array access
+// plus a position check.  Inserting into an occupied slot replaces the
+// chunk left there by a window that has since slid on.
+//
+// Width and height are rounded up to powers of two so the modulo is a mask
+// that also wraps negative positions.
+template <typename T>
+class ChunkGrid {
+    public:
+        ChunkGrid(int minWidth = 1, int minHeight = 1) { reset(minWidth, minHeight); };
+        void reset(int minWidth, int minHeight);
+        inline T* find(int x, int y);
+        inline const T* find(int x, int y) const;
+        T& insert(int x, int y, T&& value);
+        bool erase(int x, int y);
+        void clear();
+        template <typename Func> void forEach(Func func);
+        template <typename Func> void forEach(Func func) const;
+        template <typename Func> void eraseIf(Func func);
+
+        size_t size() const { return numUsed; };
+        int getWidth() const { return maskX + 1; };
+        int getHeight() const { return maskY + 1; };
+
+    private:
+        struct Slot {
+            vec2i_t pos;
+            std::optional<T> value;
+        };
+
+        Slot& at(int x, int y) { return slots[size_t(y & maskY) * size_t(maskX + 1) + size_t(x & maskX)]; };
+        const Slot& at(int x, int y) const { return slots[size_t(y & maskY) * size_t(maskX + 1) + size_t(x & maskX)]; };
+
+        std::vector<Slot> slots;
+        int maskX;
+        int maskY;
+        size_t numUsed = 0;
+};
+
+// =============================================================================
+// Reset
+// =============================================================================
+// Empties the grid and resizes it.
+template <typename T>
+void ChunkGrid<T>::reset(int minWidth, int minHeight) {
+
+    int width = 1;
+    while (width < minWidth) {
+        width <<= 1;
+    }
+    int height = 1;
+    while (height < minHeight) {
+        height <<= 1;
+    }
+
+    maskX = width - 1;
+    maskY = height - 1;
+    slots.clear();
+    slots.resize(size_t(width) * size_t(height));
+    numUsed = 0;
+}
+
+// =============================================================================
+// Find
+// =============================================================================
+template <typename T>
+T* ChunkGrid<T>::find(int x, int y) {
+    Slot& slot = at(x, y);
+    if (slot.value && slot.pos.x == x && slot.pos.y == y) {
+        return &*slot.value;
+    }
+    return nullptr;
+}
+
+template <typename T>
+const T* ChunkGrid<T>::find(int x, int y) const {
+    const Slot& slot = at(x, y);
+    if (slot.value && slot.pos.x == x && slot.pos.y == y) {
+        return &*slot.value;
+    }
+    return nullptr;
+}
+
+// =============================================================================
+// Insert
+// =============================================================================
+template <typename T>
+T& ChunkGrid<T>::insert(int x, int y, T&& value) {
+    Slot& slot = at(x, y);
+    if (!slot.value) {
+        numUsed++;
+    }
+    slot.pos.x = x;
+    slot.pos.y = y;
+    slot.value.reset();
+    slot.value.emplace(std::move(value));
+    return *slot.value;
+}
+
+// =============================================================================
+// Erase
+// =============================================================================
+template <typename T>
+bool ChunkGrid<T>::erase(int x, int y) {
+    if (find(x, y) == nullptr) {
+        return false;
+    }
+    at(x, y).value.reset();
+    numUsed--;
+    return true;
+}
+
+// =============================================================================
+// Clear
+// =============================================================================
+template <typename T>
+void ChunkGrid<T>::clear() {
+    for (Slot& slot : slots) {
+        slot.value.reset();
+    }
+    numUsed = 0;
+}
+
+// =============================================================================
+// For Each
+// =============================================================================
+// Calls func(vec2i_t pos, T& value) for every occupied slot.
+template <typename T>
+template <typename Func>
+void ChunkGrid<T>::forEach(Func func) {
+    for (Slot& slot : slots) {
+        if (slot.value) {
+            func(slot.pos, *slot.value);
+        }
+    }
+}
+
+template <typename T>
+template <typename Func>
+void ChunkGrid<T>::forEach(Func func) const {
+    for (const Slot& slot : slots) {
+        if (slot.value) {
+            func(slot.pos, *slot.value);
+        }
+    }
+}
+
+// =============================================================================
+// Erase If
+// =============================================================================
+// Erases every occupied slot for which func(vec2i_t pos, T& value) is true.
+template <typename T>
+template <typename Func>
+void ChunkGrid<T>::eraseIf(Func func) {
+    for (Slot& slot : slots) {
+        if (slot.value && func(slot.pos, *slot.value)) {
+            slot.value.reset();
+            numUsed--;
+        }
+    }
+}
+
+#endif // CHUNK_GRID_H
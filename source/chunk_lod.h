@@ -0,0 +1,379 @@
+#ifndef CHUNK_LOD_H
+#define CHUNK_LOD_H
+
+// local includes
+#include "types.h"
+#ifndef RTS_HEADLESS
+#include "shader.h"
+#endif
+#include "autotile.h"
+#include "camera.h"
+#include "chunk.h"
+#include "chunk_atlas.h"
+#include "chunk_grid.h"
+
+/// third party includes
+#include <GL/glew.h>
+
+// STL includes
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// definitions
+#define LOD_SUPER_CHUNKS_SHIFT 2
+#define LOD_SUPER_CHUNKS (1 << LOD_SUPER_CHUNKS_SHIFT) // chunks per super-chunk side
+#define LOD_TEXELS_X (CHUNK_TILES_X * LOD_SUPER_CHUNKS) // one texel per tile
+#define LOD_TEXELS_Y (CHUNK_TILES_Y * LOD_SUPER_CHUNKS)
+#define LOD_ZOOM_THRESHOLD 0.25f // below this zoom a tile covers under 4 pixels
+#define LOD_VERT_SHADER_FILEPATH "D:/_projects/rts-engine/resources/shaders/lod_vert.glsl"
+#define LOD_FRAG_SHADER_FILEPATH "D:/_projects/rts-engine/resources/shaders/lod_frag.glsl"
+
+// binding points (must match lod_vert.glsl and lod_frag.glsl)
+#define LOD_POSITIONS_SSBO_BINDING 2
+#define LOD_TEXTURE_UNIT 1
+
+// =============================================================================
+// ChunkLodRenderer Class
+// =============================================================================
+// Far zoom level of detail.  Groups of 4x4 chunks (super-chunks) are reduced
+// to one texture layer holding the average atlas color of every tile, and
+// each super-chunk is drawn as a single quad, so a zoomed out view costs six
+// vertices per sixteen chunks instead of six per tile.
+//
+// Layers are updated per chunk: addChunk() and removeChunk() rewrite only
+// the chunk's 32x32 texel block and updateTiles() the texels of an edited
+// rectangle.  Blocks of chunks that are not loaded are transparent and
+// discarded by the shader.
+class ChunkLodRenderer {
+    public:
+        ChunkLodRenderer() {};
+        ~ChunkLodRenderer();
+        ChunkLodRenderer(const ChunkLodRenderer&) = delete;
+        ChunkLodRenderer& operator=(const ChunkLodRenderer&) = delete;
+        void init(int numChunksX, int numChunksY, const ChunkAtlas& atlas);
+        void addChunk(const Chunk& chunk);
+        void updateTiles(const Chunk& chunk, TileRect rect);
+        void removeChunk(int chunkX, int chunkY);
+        void render(Camera& camera);
+        int getNumSuperChunks() { return int(superChunks.size()); };
+        int getNumDrawnSuperChunks() { return int(commands.size()); };
+#ifndef RTS_HEADLESS
+        Shader& getShader() { return shader; };
+#endif
+
+    private:
+        struct SuperChunk {
+            int slot;
+            int numChunks;
+        };
+
+        struct DrawCommand {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint first;
+            GLuint baseInstance;
+        };
+
+        void uploadBlock(int slot, int chunkX, int chunkY, const std::uint32_t* texels);
+
+        bool isInitialized = false;
+        bool isCommandsDirty = true;
+        int numSlots = 0;
+        std::uint32_t colors[256];
+
+        ChunkGrid<SuperChunk> superChunks;
+        std::vector<int> freeSlots;
+        std::vector<vec2i_t> slotPositions;
+        std::vector<bool> slotsUsed;
+        std::vector<DrawCommand> commands;
+        std::vector<std::uint32_t> block; // texels of one chunk
+        vec2i_t visibleMin; // visible super-chunk range the commands were built for
+        vec2i_t visibleMax;
+
+#ifndef RTS_HEADLESS
+        Shader shader;
+        GLint projectionLocation = -1;
+        GLint viewLocation = -1;
+        int shaderRevision = 0; // revision the locations were fetched for
+#endif
+        GLuint vaoId = 0;
+        GLuint textureId = 0;
+        GLuint positionsSsboId = 0;
+        GLuint commandsBufferId = 0;
+};
+
+// =============================================================================
+// Destruct ChunkLodRenderer
+// =============================================================================
+ChunkLodRenderer::~ChunkLodRenderer() {
+#ifndef RTS_HEADLESS
+    if (!isInitialized) {
+        return;
+    }
+
+    glDeleteTextures(1, &textureId);
+    glDeleteBuffers(1, &positionsSsboId);
+    glDeleteBuffers(1, &commandsBufferId);
+    glDeleteVertexArrays(1, &vaoId);
+#endif
+}
+
+// =============================================================================
+// Initialize
+// =============================================================================
+// numChunksX and numChunksY bound the window of chunks that may be added at
+// the same time.
+void ChunkLodRenderer::init(int numChunksX, int numChunksY, const ChunkAtlas& atlas) {
+
+    // a window of n chunks overlaps at most n / 4 + 2 super-chunks per axis
+    int numSuperX = numChunksX / LOD_SUPER_CHUNKS + 2;
+    int numSuperY = numChunksY / LOD_SUPER_CHUNKS + 2;
+    numSlots = numSuperX * numSuperY;
+
+    superChunks.reset(numSuperX, numSuperY);
+    slotPositions.assign(numSlots, vec2i_t());
+    slotsUsed.assign(numSlots, false);
+    commands.reserve(numSlots);
+    block.resize(CHUNK_TILES);
+
+    freeSlots.clear();
+    for (int s = numSlots - 1; s >= 0; s--) {
+        freeSlots.push_back(s);
+    }
+
+    // with a blob set per tile type the fully surrounded variant stands for
+    // the tile, matching the layers ChunkRenderer selects
+    bool hasBlobSets = atlas.getNumLayers() >= TILE_TYPES * AUTOTILE_VARIANTS;
+    for (int i = 0; i < 256; i++) {
+        colors[i] = atlas.getTileColor(hasBlobSets ? i * AUTOTILE_VARIANTS + AUTOTILE_VARIANTS - 1 : i);
+    }
+
+    visibleMin.x = 0;
+    visibleMin.y = 0;
+    visibleMax.x = -1;
+    visibleMax.y = -1;
+
+#ifndef RTS_HEADLESS
+    shader = Shader(
+        std::string(LOD_VERT_SHADER_FILEPATH),
+        std::string(LOD_FRAG_SHADER_FILEPATH)
+    );
+    projectionLocation = shader.getUniformLocation("projection");
+    viewLocation = shader.getUniformLocation("view");
+
+    glGenVertexArrays(1, &vaoId);
+
+    // one layer per super-chunk slot, sampled without filtering so each tile
+    // stays one flat color
+    glGenTextures(1, &textureId);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureId);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, LOD_TEXELS_X, LOD_TEXELS_Y, numSlots);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenBuffers(1, &positionsSsboId);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, positionsSsboId);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, numSlots * 2 * sizeof(GLint), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glGenBuffers(1, &commandsBufferId);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandsBufferId);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, numSlots * sizeof(DrawCommand), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+#endif
+
+    isInitialized = true;
+}
+
+// =============================================================================
+// Add Chunk
+// =============================================================================
+void ChunkLodRenderer::addChunk(const Chunk& chunk) {
+
+    vec2i_t pos = chunk.getPosition();
+    int sx = pos.x >> LOD_SUPER_CHUNKS_SHIFT;
+    int sy = pos.y >> LOD_SUPER_CHUNKS_SHIFT;
+
+    SuperChunk* super = superChunks.find(sx, sy);
+    if (super == nullptr) {
+        if (freeSlots.empty()) {
+            std::cout << "WARNING: out of super-chunk slots" << std::endl;
+            return;
+        }
+
+        SuperChunk s;
+        s.slot = freeSlots.back();
+        s.numChunks = 0;
+        freeSlots.pop_back();
+        super = &superChunks.insert(sx, sy, std::move(s));
+
+        slotsUsed[super->slot] = true;
+        slotPositions[super->slot].x = sx;
+        slotPositions[super->slot].y = sy;
+        isCommandsDirty = true;
+
+#ifndef RTS_HEADLESS
+        // start fully transparent; blocks appear as their chunks are added
+        glClearTexSubImage(textureId, 0, 0, 0, super->slot, LOD_TEXELS_X, LOD_TEXELS_Y, 1,
+            GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        GLint position[2] = {sx, sy};
+        glNamedBufferSubData(positionsSsboId, super->slot * sizeof(position), sizeof(position), position);
+#endif
+    }
+    super->numChunks++;
+
+    // reduce every tile to its average atlas color
+    const TileStorage& tiles = chunk.getStorage();
+    for (int i = 0; i < CHUNK_TILES; i++) {
+        block[i] = colors[tiles.get(i)];
+    }
+    uploadBlock(super->slot, pos.x, pos.y, block.data());
+}
+
+// =============================================================================
+// Update Tiles
+// =============================================================================
+// Rewrites the texels of one chunk's tiles inside rect with a single upload.
+void ChunkLodRenderer::updateTiles(const Chunk& chunk, TileRect rect) {
+
+    vec2i_t pos = chunk.getPosition();
+    SuperChunk* super = superChunks.find(pos.x >> LOD_SUPER_CHUNKS_SHIFT, pos.y >> LOD_SUPER_CHUNKS_SHIFT);
+    if (super == nullptr || rect.isEmpty()) {
+        return;
+    }
+
+    int width = rect.getWidth();
+    for (int y = rect.minY; y <= rect.maxY; y++) {
+        for (int x = rect.minX; x <= rect.maxX; x++) {
+            block[(y - rect.minY) * width + (x - rect.minX)] = colors[chunk.getTile(x, y)];
+        }
+    }
+
+#ifndef RTS_HEADLESS
+    int u = (pos.x & (LOD_SUPER_CHUNKS - 1)) * CHUNK_TILES_X + rect.minX;
+    int v = (pos.y & (LOD_SUPER_CHUNKS - 1)) * CHUNK_TILES_Y + rect.minY;
+    glTextureSubImage3D(textureId, 0, u, v, super->slot, width, rect.getHeight(), 1,
+        GL_RGBA, GL_UNSIGNED_BYTE, block.data());
+#endif
+}
+
+// =============================================================================
+// Remove Chunk
+// =============================================================================
+void ChunkLodRenderer::removeChunk(int chunkX, int chunkY) {
+
+    int sx = chunkX >> LOD_SUPER_CHUNKS_SHIFT;
+    int sy = chunkY >> LOD_SUPER_CHUNKS_SHIFT;
+
+    SuperChunk* super = superChunks.find(sx, sy);
+    if (super == nullptr) {
+        return;
+    }
+
+    // the last chunk frees the whole layer
+    if (--super->numChunks == 0) {
+        slotsUsed[super->slot] = false;
+        freeSlots.push_back(super->slot);
+        superChunks.erase(sx, sy);
+        isCommandsDirty = true;
+        return;
+    }
+
+    std::fill(block.begin(), block.end(), 0u);
+    uploadBlock(super->slot, chunkX, chunkY, block.data());
+}
+
+// =============================================================================
+// Upload Block
+// =============================================================================
+void ChunkLodRenderer::uploadBlock(int slot, int chunkX, int chunkY, const std::uint32_t* texels) {
+#ifndef RTS_HEADLESS
+    int u = (chunkX & (LOD_SUPER_CHUNKS - 1)) * CHUNK_TILES_X;
+    int v = (chunkY & (LOD_SUPER_CHUNKS - 1)) * CHUNK_TILES_Y;
+    glTextureSubImage3D(textureId, 0, u, v, slot, CHUNK_TILES_X, CHUNK_TILES_Y, 1,
+        GL_RGBA, GL_UNSIGNED_BYTE, texels);
+#else
+    (void)slot;
+    (void)chunkX;
+    (void)chunkY;
+    (void)texels;
+#endif
+}
+
+// =============================================================================
+// Render
+// =============================================================================
+void ChunkLodRenderer::render(Camera& camera) {
+
+    // super-chunks overlapping the visible rectangle
+    vec2f_t viewMin, viewMax;
+    camera.getViewBounds(viewMin, viewMax);
+
+    vec2i_t superMin, superMax;
+    superMin.x = getChunkCoordX(viewMin.x) >> LOD_SUPER_CHUNKS_SHIFT;
+    superMin.y = getChunkCoordY(viewMin.y) >> LOD_SUPER_CHUNKS_SHIFT;
+    superMax.x = getChunkCoordX(viewMax.x) >> LOD_SUPER_CHUNKS_SHIFT;
+    superMax.y = getChunkCoordY(viewMax.y) >> LOD_SUPER_CHUNKS_SHIFT;
+
+    if (superMin.x != visibleMin.x || superMin.y != visibleMin.y ||
+        superMax.x != visibleMax.x || superMax.y != visibleMax.y) {
+        visibleMin = superMin;
+        visibleMax = superMax;
+        isCommandsDirty = true;
+    }
+
+    if (isCommandsDirty) {
+        commands.clear();
+        for (int s = 0; s < numSlots; s++) {
+            vec2i_t pos = slotPositions[s];
+            if (slotsUsed[s] &&
+                pos.x >= visibleMin.x && pos.x <= visibleMax.x &&
+                pos.y >= visibleMin.y && pos.y <= visibleMax.y) {
+                commands.push_back({6, 1, 0, GLuint(s)});
+            }
+        }
+    }
+
+#ifndef RTS_HEADLESS
+    if (isCommandsDirty) {
+        glNamedBufferSubData(commandsBufferId, 0, commands.size() * sizeof(DrawCommand), commands.data());
+    }
+
+    // locations can move when the program is reloaded
+    if (shader.getRevision() != shaderRevision) {
+        projectionLocation = shader.getUniformLocation("projection");
+        viewLocation = shader.getUniformLocation("view");
+        shaderRevision = shader.getRevision();
+    }
+
+    shader.setUniform(projectionLocation, camera.projMat);
+    shader.setUniform(viewLocation, camera.viewMat);
+
+    glUseProgram(shader.getProgId());
+    glBindVertexArray(vaoId);
+    glActiveTexture(GL_TEXTURE0 + LOD_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureId);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LOD_POSITIONS_SSBO_BINDING, positionsSsboId);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandsBufferId);
+
+    // one quad per visible super-chunk
+    glMultiDrawArraysIndirect(GL_TRIANGLES, nullptr, GLsizei(commands.size()), 0);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+#endif
+
+    isCommandsDirty = false;
+}
+
+#endif // CHUNK_LOD_H
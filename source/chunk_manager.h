@@ -3,134 +3,889 @@
 
 // local includes
 #include "types.h"
+#include "autotile.h"
+#include "camera.h"
 #include "chunk.h"
+#include "chunk_grid.h"
+#include "chunk_lod.h"
+#include "chunk_mesh.h"
+#include "chunk_renderer.h"
+#include "flow_field.h"
+#include "pathfinder.h"
+#include "terrain.h"
+#include "region.h"
+#include "lock_free_queue.h"
+#include "thread_pool.h"
+#ifndef RTS_HEADLESS
+#include "shader_watcher.h"
+#endif
 
 // third party includes
 
 // STL includes
-#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
+// definitions
+#define CHUNK_LOAD_MARGIN 1 // chunks prefetched beyond the visible radius
+#define CHUNK_RADIUS_MAX 64 // visible radius limit when zoomed far out
+#define CHUNK_EVICT_MARGIN 1 // chunks and meshes dropped only this far past their area
+#define CHUNK_LOOKAHEAD_FRAMES 30.0f // camera velocity look ahead for load priority
+#define CHUNK_WORKER_THREADS 0 // 0 picks one worker per spare core
+#define CHUNK_UPLOAD_BUDGET_MS 2.0 // main thread time spent on finished chunks per frame
+#define CHUNK_FINISHED_QUEUE_SIZE 1024 // chunks generated but not yet received
+
 // =============================================================================
 // Chunk Manager Class
 // =============================================================================
+// Chunks are generated on a worker pool.  update() submits a job for every
+// chunk entering the load area and, on the calling (OpenGL) thread, drains
+// finished chunks from a lock-free queue within a per-frame time budget.
+// Workers load chunks saved in region files instead of generating them, and
+// modified chunks are queued for saving when they leave the load area.
+// Resident chunks, meshes, and pending jobs are kept in toroidal grids
+// around the camera rather than hash maps.
+//
+// When the camera crosses a chunk boundary only the strips entering and
+// leaving each window are visited.  Entering chunks wait in a load queue
+// ordered by distance to where the camera will be given its velocity.  Each
+// job pops the most urgent entry when a worker runs it, so the order can
+// change while jobs are waiting.  Chunks and meshes are kept until they are
+// a margin past their area, so moving back and forth across a boundary does
+// not reload them.
+//
+// The render radius follows the camera's visible rectangle, so zooming out
+// streams more chunks and zooming in fewer; the load radius adds a prefetch
+// margin.  init() sizes the grids for the rectangle at the minimum zoom.
+// Below LOD_ZOOM_THRESHOLD chunks are drawn as super-chunk quads instead of
+// tiles; see ChunkLodRenderer.  No meshes are built while zoomed out.  After
+// zooming back in the render area is meshed within the upload budget and the
+// quads are drawn until every visible chunk has its mesh.
+//
+// Meshes carry an autotile variant per tile.  Masks look across chunk
+// borders into the neighboring resident chunks; a missing neighbor repeats
+// the chunk's own edge.  A chunk arriving next to meshed chunks re-masks
+// their bordering tiles.
+//
+// Tiles are edited through setTile() and fillRect().  Edits only grow each
+// chunk's dirty rectangle; once per update() every edited chunk re-masks
+// that rectangle plus a one tile border and uploads just those tiles, so
+// any number of edits in a frame cost one upload per chunk.
+//
+// Edited chunks are saved under the directory given to the constructor when
+// they are evicted and loaded from there instead of being generated again.
+//
+// The pathfinder mirrors the resident chunks: it is told about every chunk
+// received, evicted or edited and rebuilds its clusters lazily.  Flow
+// fields for group orders are built from its walkability on the same
+// workers that generate chunks.
 class ChunkManager {
     public:
-        ChunkManager();
-        void update(vec3f_t cameraPos);
+        ChunkManager(const std::string& saveDirectory = REGION_DIRECTORY);
+        ~ChunkManager();
+        void init(const Camera& camera);
+        void init(vec2f_t viewSizeMax);
+        void setSeed(unsigned int seed) { generator.setSeed(seed); };
+        void update(const Camera& camera, vec2f_t cameraVel = {{0.0f, 0.0f}});
+        void update(vec2f_t viewMin, vec2f_t viewMax, vec2f_t cameraVel = {{0.0f, 0.0f}});
+        void flush();
         void render(Camera& camera);
+#ifndef RTS_HEADLESS
+        void watchShaders(ShaderWatcher& watcher);
+#endif
+        bool setTile(int tileX, int tileY, std::uint8_t tile);
+        bool fillRect(int minX, int minY, int maxX, int maxY, std::uint8_t tile);
+        Pathfinder& getPathfinder() { return pathfinder; };
+        FlowFieldCache& getFlowFields() { return flowFields; };
 
-        vec2i_t getChunkPositionAt(vec3f_t cameraPos);
+        vec2i_t getChunkPositionAt(vec3f_t pos);
+        vec2i_t getRadius() { vec2i_t r; r.x = radiusX; r.y = radiusY; return r; };
+        Chunk* getChunk(int x, int y) { return chunks.find(x, y); };
+        size_t getNumChunks() { return chunks.size(); };
+        size_t getNumMeshes() { return meshes.size(); };
+        size_t getNumPending();
+        size_t getNumLoaded() { return numLoaded; };
+        int getNumDrawn() { return renderer.getNumDrawnSlots(); };
 
     private:
-        size_t hash(const int& a, const int& b);
-    
-        int radiusX;
-        int radiusY;
+        template <typename Func>
+        static void forEachLeaving(vec2i_t from, int fromRX, int fromRY, vec2i_t to, int toRX, int toRY, Func func);
+        void stream(vec2i_t chunkPos, int newRadiusX, int newRadiusY);
+        void prioritize(vec2f_t viewCenter, vec2f_t cameraVel);
+        void generate();
+        void receive(double budgetMs);
+        void showChunk(const Chunk& chunk);
+        void setupMesh(const Chunk& chunk);
+        void meshRenderArea(double budgetMs);
+        void padTiles(const Chunk& chunk, TileArray2D& tiles, PaddedTileArray2D& padded, int minY = 0, int maxY = CHUNK_TILES_Y - 1);
+        void uploadEdits();
+        void markRemask(int minX, int minY, int maxX, int maxY);
+        std::uint8_t getTileAt(int tileX, int tileY, const Chunk& fallback);
+        bool isInsideLoadArea(vec2i_t pos);
+        bool isInsideRenderArea(vec2i_t pos);
+
+        int radiusMaxX = 0;
+        int radiusMaxY = 0;
+        int radiusX = 0;
+        int radiusY = 0;
+        int loadRadiusX = 0;
+        int loadRadiusY = 0;
+        int keepRadiusX = 0;
+        int keepRadiusY = 0;
         vec2i_t chunkPosPrev;
-        std::unordered_map<size_t, Chunk> chunks;
+        bool hasStreamed = false;
+        bool isZoomedOut = false; // below LOD_ZOOM_THRESHOLD, no meshes are built
+        bool hasMissingMeshes = false; // render area not meshed since zooming in
+        TerrainGenerator generator;
+        RegionStore store;
+        ChunkRenderer renderer; // must outlive meshes
+        ChunkLodRenderer lod;
+        ChunkGrid<Chunk> chunks;
+        ChunkGrid<ChunkMesh> meshes;
+        ChunkGrid<bool> shown; // chunks in the LOD layers
+        ChunkGrid<bool> pending; // queued or generating, not yet received
+        Pathfinder pathfinder; // mirrors the resident chunks
+        FlowFieldCache flowFields; // sweeps on the workers
+        size_t numLoaded = 0; // chunks received since construction
+        std::vector<vec2i_t> editedChunks; // chunks with a dirty rectangle
+        std::vector<vec2i_t> remaskedMeshes; // meshes with a dirty rectangle
+
+        // shared with the workers
+        std::mutex loadMutex;
+        std::vector<vec2i_t> loadQueue; // most urgent last
+        std::atomic<int> numGenerating; // including chunks that left the load area
+
+        // declared last so the workers are joined before anything they use
+        // is destroyed
+        std::atomic<bool> isStopping;
+        LockFreeQueue<Chunk> finished;
+        ThreadPool workers;
 };
 
 // =============================================================================
 // Construct Chunk Manager
 // =============================================================================
-ChunkManager::ChunkManager() {
+ChunkManager::ChunkManager(const std::string& saveDirectory)
+        : store(saveDirectory),
+          flowFields(pathfinder, workers),
+          numGenerating(0),
+          isStopping(false),
+          finished(CHUNK_FINISHED_QUEUE_SIZE),
+          workers(CHUNK_WORKER_THREADS) {
+
+    chunkPosPrev.x = 0;
+    chunkPosPrev.y = 0;
+}
+
+// =============================================================================
+// Destruct Chunk Manager
+// =============================================================================
+ChunkManager::~ChunkManager() {
+
+    // release workers waiting on a full queue so the pool can join them
+    isStopping = true;
+
+    // the store finishes queued writes before it is destroyed
+    chunks.forEach([this](vec2i_t, Chunk& chunk) {
+        if (chunk.isDirty) {
+            store.save(chunk);
+        }
+    });
+}
+
+// =============================================================================
+// Initialize
+// =============================================================================
+void ChunkManager::init(const Camera& camera) {
+
+    // the visible rectangle is largest at the minimum zoom
+    Camera zoomedOut = camera;
+    zoomedOut.zoomView(CAMERA_ZOOM_MIN);
+
+    vec2f_t viewMin, viewMax;
+    zoomedOut.getViewBounds(viewMin, viewMax);
+
+    vec2f_t viewSize;
+    viewSize.x = viewMax.x - viewMin.x;
+    viewSize.y = viewMax.y - viewMin.y;
+    init(viewSize);
+}
+
+// =============================================================================
+// Initialize
+// =============================================================================
+// viewSizeMax is the largest visible rectangle in world pixels.
+void ChunkManager::init(vec2f_t viewSizeMax) {
+
+    // a rectangle centered anywhere in the center chunk
+    radiusMaxX = std::min(CHUNK_RADIUS_MAX, int(std::ceil(0.5f * viewSizeMax.x / CHUNK_PIXELS_X + 0.5f)));
+    radiusMaxY = std::min(CHUNK_RADIUS_MAX, int(std::ceil(0.5f * viewSizeMax.y / CHUNK_PIXELS_Y + 0.5f)));
+
+    int keepMaxX = radiusMaxX + CHUNK_LOAD_MARGIN + CHUNK_EVICT_MARGIN;
+    int keepMaxY = radiusMaxY + CHUNK_LOAD_MARGIN + CHUNK_EVICT_MARGIN;
+    int meshMaxX = radiusMaxX + CHUNK_EVICT_MARGIN;
+    int meshMaxY = radiusMaxY + CHUNK_EVICT_MARGIN;
+
+    chunks.reset(2 * keepMaxX + 1, 2 * keepMaxY + 1);
+    pathfinder.reset(2 * keepMaxX + 1, 2 * keepMaxY + 1);
+    flowFields.clear();
+    meshes.reset(2 * meshMaxX + 1, 2 * meshMaxY + 1);
+    shown.reset(2 * meshMaxX + 1, 2 * meshMaxY + 1);
+    pending.reset(2 * (radiusMaxX + CHUNK_LOAD_MARGIN) + 1, 2 * (radiusMaxY + CHUNK_LOAD_MARGIN) + 1);
+
+    // twice the kept meshes so slots freed while a frame is still in flight
+    // do not starve newly visible chunks
+    int numSlots = 2 * (2 * meshMaxX + 1) * (2 * meshMaxY + 1);
+    renderer.init(numSlots);
+    lod.init(2 * meshMaxX + 1, 2 * meshMaxY + 1, renderer.getAtlas());
+}
+
+// =============================================================================
+// Update
+// =============================================================================
+// cameraVel is the camera movement per frame in pixels.
+void ChunkManager::update(const Camera& camera, vec2f_t cameraVel) {
+
+    // meshes skipped while zoomed out are built once the tiles are drawn again
+    bool isZoomedOutNow = camera.zoom < LOD_ZOOM_THRESHOLD;
+    if (isZoomedOut && !isZoomedOutNow) {
+        hasMissingMeshes = true;
+    }
+    isZoomedOut = isZoomedOutNow;
 
-    radiusX = 1;
-    radiusY = 1;
+    vec2f_t viewMin, viewMax;
+    camera.getViewBounds(viewMin, viewMax);
+    update(viewMin, viewMax, cameraVel);
 }
 
 // =============================================================================
 // Update
 // =============================================================================
-void ChunkManager::update(vec3f_t cameraPos) {
+// viewMin and viewMax bound the visible rectangle in world pixels.
+void ChunkManager::update(vec2f_t viewMin, vec2f_t viewMax, vec2f_t cameraVel) {
+
+    vec2f_t viewCenter;
+    viewCenter.x = 0.5f * (viewMin.x + viewMax.x);
+    viewCenter.y = 0.5f * (viewMin.y + viewMax.y);
 
-    // get current chunk position
-    vec2i_t chunkPos = getChunkPositionAt(cameraPos);
+    // smallest window around the center chunk covering the visible chunks
+    vec2i_t chunkPos = getChunkPositionAt({{viewCenter.x, viewCenter.y, 0.0f}});
+    vec2i_t chunkMin = getChunkPositionAt({{viewMin.x, viewMin.y, 0.0f}});
+    vec2i_t chunkMax = getChunkPositionAt({{viewMax.x, viewMax.y, 0.0f}});
 
-    // check if chunk position changed
-    if (chunkPos.x == chunkPosPrev.x && chunkPos.y == chunkPosPrev.y) {
-        return;
+    int newRadiusX = std::min(radiusMaxX, std::max(chunkPos.x - chunkMin.x, chunkMax.x - chunkPos.x));
+    int newRadiusY = std::min(radiusMaxY, std::max(chunkPos.y - chunkMin.y, chunkMax.y - chunkPos.y));
+
+    // stream chunks if the window moved or changed size
+    if (!hasStreamed ||
+        chunkPos.x != chunkPosPrev.x || chunkPos.y != chunkPosPrev.y ||
+        newRadiusX != radiusX || newRadiusY != radiusY) {
+        stream(chunkPos, newRadiusX, newRadiusY);
+        hasStreamed = true;
+        prioritize(viewCenter, cameraVel);
     }
 
-    // deactivate all chunks
-    for (auto &i : chunks) {
-        i.second.active = false;
+    // take in chunks finished by the workers
+    receive(CHUNK_UPLOAD_BUDGET_MS);
+
+    // mesh the chunks left unmeshed while zoomed out
+    if (hasMissingMeshes && !isZoomedOut) {
+        meshRenderArea(CHUNK_UPLOAD_BUDGET_MS);
     }
 
-    // loop through chunk activation area
-    int xBeg = chunkPos.x - radiusX;
-    int xEnd = chunkPos.x + radiusX;
-    int yBeg = chunkPos.y - radiusY;
-    int yEnd = chunkPos.y + radiusY;
+    // upload tiles edited since the last update
+    uploadEdits();
+}
 
-    for (int y = yBeg; y <= yEnd; y++) {
-        for (int x = xBeg; x <= xEnd; x++) {
-            size_t h = hash(x, y);
+// =============================================================================
+// Flush
+// =============================================================================
+// Blocks until every queued chunk has been received.
+void ChunkManager::flush() {
+    while (getNumPending() > 0) {
+        receive(0.0);
+        std::this_thread::yield();
+    }
+    if (hasMissingMeshes && !isZoomedOut) {
+        meshRenderArea(0.0);
+    }
+    uploadEdits();
+}
 
-            // setup new chunks if not currently in the chunks map
-            std::unordered_map<size_t, Chunk>::const_iterator i = chunks.find(h);
-            if (i == chunks.end()) {
-                chunks[h] = Chunk();
-                chunks[h].updatePosition(x, y);
-                chunks[h].updateTiles();
-                chunks[h].bufferData();
+// =============================================================================
+// Get Number of Pending Chunks
+// =============================================================================
+size_t ChunkManager::getNumPending() {
+    std::lock_guard<std::mutex> lock(loadMutex);
+    return loadQueue.size() + size_t(numGenerating);
+}
+
+// =============================================================================
+// For Each Leaving
+// =============================================================================
+// Calls func(x, y) for every position in the window of radius fromRX, fromRY
+// around from that is outside the window of radius toRX, toRY around to.
+// Only the leaving strips are visited, so the cost follows the distance
+// moved rather than the area.
+template <typename Func>
+void ChunkManager::forEachLeaving(vec2i_t from, int fromRX, int fromRY, vec2i_t to, int toRX, int toRY, Func func) {
+
+    int xBeg = from.x - fromRX;
+    int xEnd = from.x + fromRX;
+
+    for (int y = from.y - fromRY; y <= from.y + fromRY; y++) {
+
+        // whole rows outside the new window
+        if (std::abs(y - to.y) > toRY) {
+            for (int x = xBeg; x <= xEnd; x++) {
+                func(x, y);
             }
+            continue;
+        }
 
-            // activate chunks within chunk activation area
-            chunks[h].active = true;
+        // columns left and right of the new window
+        for (int x = xBeg; x <= std::min(xEnd, to.x - toRX - 1); x++) {
+            func(x, y);
+        }
+        for (int x = std::max(xBeg, to.x + toRX + 1); x <= xEnd; x++) {
+            func(x, y);
         }
     }
+}
 
-    // select inactive chunks
-    std::vector<size_t> inactives;
-    for (auto &i : chunks) {
-        if (i.second.active == false) {
-            vec2i_t pos = i.second.getPosition();
-            size_t h = hash(pos.x, pos.y);
-            inactives.emplace_back(h);
-        }
+// =============================================================================
+// Stream
+// =============================================================================
+void ChunkManager::stream(vec2i_t chunkPos, int newRadiusX, int newRadiusY) {
+
+    int newLoadRadiusX = newRadiusX + CHUNK_LOAD_MARGIN;
+    int newLoadRadiusY = newRadiusY + CHUNK_LOAD_MARGIN;
+    int newKeepRadiusX = newLoadRadiusX + CHUNK_EVICT_MARGIN;
+    int newKeepRadiusY = newLoadRadiusY + CHUNK_EVICT_MARGIN;
+
+    if (hasStreamed) {
+
+        // evict chunks past the keep area, saving modified ones
+        forEachLeaving(chunkPosPrev, keepRadiusX, keepRadiusY,
+                chunkPos, newKeepRadiusX, newKeepRadiusY, [this](int x, int y) {
+            Chunk* chunk = chunks.find(x, y);
+            if (chunk != nullptr && chunk->isDirty) {
+                store.save(*chunk);
+            }
+            chunks.erase(x, y);
+            pathfinder.removeChunk(x, y);
+        });
+
+        // delete meshes past the render area
+        forEachLeaving(chunkPosPrev, radiusX + CHUNK_EVICT_MARGIN, radiusY + CHUNK_EVICT_MARGIN,
+                chunkPos, newRadiusX + CHUNK_EVICT_MARGIN, newRadiusY + CHUNK_EVICT_MARGIN, [this](int x, int y) {
+            meshes.erase(x, y);
+            if (shown.erase(x, y)) {
+                lod.removeChunk(x, y);
+            }
+        });
     }
 
-    // delete inactive chunks from the chunks map
-    for (int i = 0; i < inactives.size(); i++) {
-        chunks.erase(inactives[i]);
+    // queue chunks entering the load area unless they are resident or pending
+    std::vector<vec2i_t> entering;
+    auto enter = [this, &entering](int x, int y) {
+        if (chunks.find(x, y) == nullptr && pending.find(x, y) == nullptr) {
+            pending.insert(x, y, true);
+            vec2i_t pos;
+            pos.x = x;
+            pos.y = y;
+            entering.push_back(pos);
+        }
+    };
+
+    // show resident chunks entering the render area
+    auto show = [this](int x, int y) {
+        Chunk* chunk = chunks.find(x, y);
+        if (chunk != nullptr) {
+            showChunk(*chunk);
+        }
+    };
+
+    if (hasStreamed) {
+        forEachLeaving(chunkPos, newLoadRadiusX, newLoadRadiusY, chunkPosPrev, loadRadiusX, loadRadiusY, enter);
+        forEachLeaving(chunkPos, newRadiusX, newRadiusY, chunkPosPrev, radiusX, radiusY, show);
+    }
+    else {
+        for (int y = chunkPos.y - newLoadRadiusY; y <= chunkPos.y + newLoadRadiusY; y++) {
+            for (int x = chunkPos.x - newLoadRadiusX; x <= chunkPos.x + newLoadRadiusX; x++) {
+                enter(x, y);
+            }
+        }
     }
 
     chunkPosPrev = chunkPos;
+    radiusX = newRadiusX;
+    radiusY = newRadiusY;
+    loadRadiusX = newLoadRadiusX;
+    loadRadiusY = newLoadRadiusY;
+    keepRadiusX = newKeepRadiusX;
+    keepRadiusY = newKeepRadiusY;
+
+    // one job per queued chunk; prioritize() orders the queue
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        loadQueue.insert(loadQueue.end(), entering.begin(), entering.end());
+    }
+    for (size_t i = 0; i < entering.size(); i++) {
+        workers.submit([this] { generate(); });
+    }
 }
 
 // =============================================================================
-// Render
+// Prioritize
 // =============================================================================
-void ChunkManager::render(Camera& camera) {
-    for (auto &i : chunks) {
-        i.second.render(camera);
+// Drops queued chunks that left the load area and orders the rest by
+// distance to where the camera is heading.  Called after stream() has moved
+// the window.
+void ChunkManager::prioritize(vec2f_t viewCenter, vec2f_t cameraVel) {
+
+    std::lock_guard<std::mutex> lock(loadMutex);
+
+    // jobs left without an entry return immediately
+    for (size_t i = 0; i < loadQueue.size();) {
+        vec2i_t pos = loadQueue[i];
+        if (!isInsideLoadArea(pos)) {
+            pending.erase(pos.x, pos.y);
+            loadQueue[i] = loadQueue.back();
+            loadQueue.pop_back();
+        }
+        else {
+            i++;
+        }
     }
+
+    // camera look ahead point in chunk units
+    float aheadX = (viewCenter.x + cameraVel.x * CHUNK_LOOKAHEAD_FRAMES) / float(CHUNK_PIXELS_X);
+    float aheadY = (viewCenter.y + cameraVel.y * CHUNK_LOOKAHEAD_FRAMES) / float(CHUNK_PIXELS_Y);
+
+    auto distance = [aheadX, aheadY](vec2i_t pos) {
+        float dx = float(pos.x) - aheadX;
+        float dy = float(pos.y) - aheadY;
+        return dx * dx + dy * dy;
+    };
+
+    // most urgent last so workers can pop from the back
+    std::sort(loadQueue.begin(), loadQueue.end(), [&distance](vec2i_t a, vec2i_t b) {
+        return distance(a) > distance(b);
+    });
 }
 
 // =============================================================================
-// Get Chunk Position At
+// Generate
 // =============================================================================
-vec2i_t ChunkManager::getChunkPositionAt(vec3f_t cameraPos) {
+// Runs on a worker thread.  Takes the most urgent queued chunk.
+void ChunkManager::generate() {
 
-    int signX = int(cameraPos.x) >> 31;
-    int signY = int(cameraPos.y) >> 31;
+    vec2i_t pos;
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        if (loadQueue.empty()) {
+            return;
+        }
+        pos = loadQueue.back();
+        loadQueue.pop_back();
+        numGenerating++;
+    }
 
-    // TODO: clean this up but be careful with the floating points!
-    vec2i_t chunkPos;
-    chunkPos.x = int(((cameraPos.x + CHUNK_PIXELS_HALF_X) / CHUNK_PIXELS_X) + signX);
-    chunkPos.y = int(((cameraPos.y + CHUNK_PIXELS_HALF_Y) / CHUNK_PIXELS_Y) + signY);
+    Chunk chunk(pos.x, pos.y);
+    if (!store.load(chunk)) {
+        generator.generate(chunk);
+    }
 
-    return chunkPos;
+    while (!finished.push(std::move(chunk))) {
+        if (isStopping) {
+            numGenerating--;
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+// =============================================================================
+// Receive
+// =============================================================================
+// Moves finished chunks into the chunks map until the budget is spent.  A
+// budget of zero drains everything that is ready.
+void ChunkManager::receive(double budgetMs) {
+
+    auto beg = std::chrono::steady_clock::now();
+    Chunk chunk;
+
+    while (finished.pop(chunk)) {
+        vec2i_t pos = chunk.getPosition();
+        pending.erase(pos.x, pos.y);
+        numGenerating--;
+
+        // the camera may have moved on while the chunk was generated
+        if (isInsideLoadArea(pos) && chunks.find(pos.x, pos.y) == nullptr) {
+            Chunk& resident = chunks.insert(pos.x, pos.y, std::move(chunk));
+            pathfinder.setChunk(resident);
+            numLoaded++;
+
+            if (isInsideRenderArea(pos)) {
+                showChunk(resident);
+            }
+
+            // neighbors masked before this chunk arrived saw a repeated edge
+            int begX = pos.x * CHUNK_TILES_X - 1;
+            int begY = pos.y * CHUNK_TILES_Y - 1;
+            int endX = begX + CHUNK_TILES_X + 1;
+            int endY = begY + CHUNK_TILES_Y + 1;
+            markRemask(begX, begY, endX, begY);
+            markRemask(begX, endY, endX, endY);
+            markRemask(begX, begY + 1, begX, endY - 1);
+            markRemask(endX, begY + 1, endX, endY - 1);
+        }
+
+        if (budgetMs > 0.0) {
+            std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - beg;
+            if (elapsed.count() >= budgetMs) {
+                break;
+            }
+        }
+    }
+}
+
+// =============================================================================
+// Show Chunk
+// =============================================================================
+// Adds a chunk in the render area to the LOD layers and, unless the view is
+// zoomed out, sets up its mesh.
+void ChunkManager::showChunk(const Chunk& chunk) {
+
+    vec2i_t pos = chunk.getPosition();
+    if (shown.find(pos.x, pos.y) == nullptr) {
+        shown.insert(pos.x, pos.y, true);
+        lod.addChunk(chunk);
+    }
+
+    if (!isZoomedOut && meshes.find(pos.x, pos.y) == nullptr) {
+        setupMesh(chunk);
+    }
+}
+
+// =============================================================================
+// Setup Mesh
+// =============================================================================
+void ChunkManager::setupMesh(const Chunk& chunk) {
+
+    TileArray2D tiles;
+    PaddedTileArray2D padded;
+    padTiles(chunk, tiles, padded);
+
+    TileArray2D variants;
+    Autotiler::computeVariants(padded, variants);
+
+    vec2i_t pos = chunk.getPosition();
+    ChunkMesh mesh(renderer);
+    mesh.updatePosition(pos.x, pos.y);
+    mesh.updateTiles(tiles, variants);
+    meshes.insert(pos.x, pos.y, std::move(mesh));
+}
+
+// =============================================================================
+// Mesh Render Area
+// =============================================================================
+// Sets up meshes for the resident chunks in the render area that have none
+// until the budget is spent.  A budget of zero meshes all of them.  Clears
+// hasMissingMeshes once a pass completes.
+void ChunkManager::meshRenderArea(double budgetMs) {
+
+    auto beg = std::chrono::steady_clock::now();
+
+    for (int y = chunkPosPrev.y - radiusY; y <= chunkPosPrev.y + radiusY; y++) {
+        for (int x = chunkPosPrev.x - radiusX; x <= chunkPosPrev.x + radiusX; x++) {
+            const Chunk* chunk = chunks.find(x, y);
+            if (chunk == nullptr || meshes.find(x, y) != nullptr) {
+                continue;
+            }
+
+            setupMesh(*chunk);
+
+            if (budgetMs > 0.0) {
+                std::chrono::duration<double, std::milli> elapsed =
+                    std::chrono::steady_clock::now() - beg;
+                if (elapsed.count() >= budgetMs) {
+                    return;
+                }
+            }
+        }
+    }
+
+    hasMissingMeshes = false;
+}
+
+// =============================================================================
+// Pad Tiles
+// =============================================================================
+// Decompresses a chunk into tiles and into padded, whose border holds the
+// edges of the neighboring chunks.  Only what masking rows minY to maxY
+// reads is filled: tile rows minY - 1 to maxY + 1 and the matching padded
+// rows.
+void ChunkManager::padTiles(const Chunk& chunk, TileArray2D& tiles, PaddedTileArray2D& padded, int minY, int maxY) {
+
+    int begY = std::max(minY - 1, 0);
+    int endY = std::min(maxY + 1, CHUNK_TILES_Y - 1);
+    if (begY == 0 && endY == CHUNK_TILES_Y - 1) {
+        chunk.getData(tiles);
+    }
+    else {
+        for (int y = begY; y <= endY; y++) {
+            for (int x = 0; x < CHUNK_TILES_X; x++) {
+                tiles[y][x] = chunk.getTile(x, y);
+            }
+        }
+    }
+
+    vec2i_t pos = chunk.getPosition();
+    int baseX = pos.x * CHUNK_TILES_X - 1;
+    int baseY = pos.y * CHUNK_TILES_Y - 1;
+    for (int y = minY; y <= maxY + 2; y++) {
+        if (y == 0 || y == CHUNK_TILES_Y + 1) {
+            for (int x = 0; x < CHUNK_TILES_X + 2; x++) {
+                padded[y][x] = getTileAt(baseX + x, baseY + y, chunk);
+            }
+        }
+        else {
+            padded[y][0] = getTileAt(baseX, baseY + y, chunk);
+            std::memcpy(&padded[y][1], tiles[y - 1], CHUNK_TILES_X);
+            padded[y][CHUNK_TILES_X + 1] = getTileAt(baseX + CHUNK_TILES_X + 1, baseY + y, chunk);
+        }
+    }
 }
 
 // =============================================================================
-// Hash
+// Set Tile
 // =============================================================================
-size_t ChunkManager::hash(const int& a, const int& b) {
-    return (size_t(a) << 32) + size_t(b);
+// Changes a tile of a resident chunk by world tile coordinate.  Returns
+// false if the chunk is not resident.  The change is uploaded by the next
+// update().
+bool ChunkManager::setTile(int tileX, int tileY, std::uint8_t tile) {
+
+    int chunkX = getChunkCoordOfTileX(tileX);
+    int chunkY = getChunkCoordOfTileY(tileY);
+    Chunk* chunk = chunks.find(chunkX, chunkY);
+    if (chunk == nullptr) {
+        return false;
+    }
+
+    int x = tileX - chunkX * CHUNK_TILES_X;
+    int y = tileY - chunkY * CHUNK_TILES_Y;
+    if (chunk->getTile(x, y) == tile) {
+        return true;
+    }
+
+    if (chunk->getDirtyRect().isEmpty()) {
+        editedChunks.push_back(chunk->getPosition());
+    }
+    chunk->setTile(x, y, tile);
+    return true;
+}
+
+// =============================================================================
+// Fill Rect
+// =============================================================================
+// Sets every tile in an inclusive rectangle of world tile coordinates.
+// Returns false if part of it lies in chunks that are not resident; those
+// tiles are left unchanged.
+bool ChunkManager::fillRect(int minX, int minY, int maxX, int maxY, std::uint8_t tile) {
+
+    bool isResident = true;
+    for (int chunkY = getChunkCoordOfTileY(minY); chunkY <= getChunkCoordOfTileY(maxY); chunkY++) {
+        for (int chunkX = getChunkCoordOfTileX(minX); chunkX <= getChunkCoordOfTileX(maxX); chunkX++) {
+            Chunk* chunk = chunks.find(chunkX, chunkY);
+            if (chunk == nullptr) {
+                isResident = false;
+                continue;
+            }
+
+            if (chunk->getDirtyRect().isEmpty()) {
+                editedChunks.push_back(chunk->getPosition());
+            }
+
+            int baseX = chunkX * CHUNK_TILES_X;
+            int baseY = chunkY * CHUNK_TILES_Y;
+            chunk->fillRect(minX - baseX, minY - baseY, maxX - baseX, maxY - baseY, tile);
+        }
+    }
+    return isResident;
+}
+
+// =============================================================================
+// Upload Edits
+// =============================================================================
+// Uploads the dirty rectangle of every edited chunk, re-masking one tile
+// further since neighbors of an edited tile can change variant.
+void ChunkManager::uploadEdits() {
+
+    for (vec2i_t pos : editedChunks) {
+        Chunk* chunk = chunks.find(pos.x, pos.y);
+        if (chunk == nullptr) {
+            continue;
+        }
+
+        TileRect rect = chunk->getDirtyRect();
+        chunk->clearDirtyRect();
+        if (rect.isEmpty()) {
+            continue;
+        }
+
+        pathfinder.setChunk(*chunk);
+
+        if (shown.find(pos.x, pos.y) != nullptr) {
+            lod.updateTiles(*chunk, rect);
+        }
+
+        int baseX = pos.x * CHUNK_TILES_X;
+        int baseY = pos.y * CHUNK_TILES_Y;
+        markRemask(baseX + rect.minX - 1, baseY + rect.minY - 1, baseX + rect.maxX + 1, baseY + rect.maxY + 1);
+    }
+    editedChunks.clear();
+
+    for (vec2i_t pos : remaskedMeshes) {
+        ChunkMesh* mesh = meshes.find(pos.x, pos.y);
+        const Chunk* chunk = chunks.find(pos.x, pos.y);
+        if (mesh == nullptr || chunk == nullptr) {
+            continue;
+        }
+
+        TileRect rect = mesh->dirtyRect;
+        mesh->dirtyRect = TileRect();
+        if (rect.isEmpty()) {
+            continue;
+        }
+
+        // the rectangle already includes the tiles around the edits; its
+        // rows are masked whole since the row kernel covers a row at once
+        TileArray2D tiles;
+        TileArray2D variants;
+        PaddedTileArray2D padded;
+        padTiles(*chunk, tiles, padded, rect.minY, rect.maxY);
+        Autotiler::computeVariants(padded, variants, rect.minY, rect.maxY);
+        mesh->updateTiles(tiles, variants, rect);
+    }
+    remaskedMeshes.clear();
+}
+
+// =============================================================================
+// Mark Remask
+// =============================================================================
+// Adds an inclusive rectangle of world tile coordinates to the dirty
+// rectangles of the meshes it overlaps.
+void ChunkManager::markRemask(int minX, int minY, int maxX, int maxY) {
+
+    for (int chunkY = getChunkCoordOfTileY(minY); chunkY <= getChunkCoordOfTileY(maxY); chunkY++) {
+        for (int chunkX = getChunkCoordOfTileX(minX); chunkX <= getChunkCoordOfTileX(maxX); chunkX++) {
+            ChunkMesh* mesh = meshes.find(chunkX, chunkY);
+            if (mesh == nullptr) {
+                continue;
+            }
+
+            if (mesh->dirtyRect.isEmpty()) {
+                vec2i_t pos;
+                pos.x = chunkX;
+                pos.y = chunkY;
+                remaskedMeshes.push_back(pos);
+            }
+
+            int baseX = chunkX * CHUNK_TILES_X;
+            int baseY = chunkY * CHUNK_TILES_Y;
+            mesh->dirtyRect.extend(
+                std::max(minX - baseX, 0),
+                std::max(minY - baseY, 0),
+                std::min(maxX - baseX, CHUNK_TILES_X - 1),
+                std::min(maxY - baseY, CHUNK_TILES_Y - 1));
+        }
+    }
+}
+
+// =============================================================================
+// Get Tile At
+// =============================================================================
+// Tile at a world tile coordinate.  If its chunk is not resident the
+// nearest tile of fallback is returned instead, so chunks at the edge of
+// the resident area look continuous.
+std::uint8_t ChunkManager::getTileAt(int tileX, int tileY, const Chunk& fallback) {
+
+    int chunkX = getChunkCoordOfTileX(tileX);
+    int chunkY = getChunkCoordOfTileY(tileY);
+    const Chunk* chunk = chunks.find(chunkX, chunkY);
+
+    if (chunk == nullptr) {
+        chunk = &fallback;
+        vec2i_t pos = fallback.getPosition();
+        chunkX = pos.x;
+        chunkY = pos.y;
+        tileX = std::min(std::max(tileX, chunkX * CHUNK_TILES_X), chunkX * CHUNK_TILES_X + CHUNK_TILES_X - 1);
+        tileY = std::min(std::max(tileY, chunkY * CHUNK_TILES_Y), chunkY * CHUNK_TILES_Y + CHUNK_TILES_Y - 1);
+    }
+
+    return chunk->getTile(tileX - chunkX * CHUNK_TILES_X, tileY - chunkY * CHUNK_TILES_Y);
+}
+
+// =============================================================================
+// Is Inside Load Area
+// =============================================================================
+bool ChunkManager::isInsideLoadArea(vec2i_t pos) {
+    return std::abs(pos.x - chunkPosPrev.x) <= loadRadiusX &&
+           std::abs(pos.y - chunkPosPrev.y) <= loadRadiusY;
+}
+
+// =============================================================================
+// Is Inside Render Area
+// =============================================================================
+bool ChunkManager::isInsideRenderArea(vec2i_t pos) {
+    return std::abs(pos.x - chunkPosPrev.x) <= radiusX &&
+           std::abs(pos.y - chunkPosPrev.y) <= radiusY;
+}
+
+// =============================================================================
+// Render
+// =============================================================================
+// The quads stand in for the tiles until the render area is meshed again.
+void ChunkManager::render(Camera& camera) {
+    if (camera.zoom < LOD_ZOOM_THRESHOLD || hasMissingMeshes) {
+        lod.render(camera);
+        renderer.endFrame();
+    }
+    else {
+        renderer.render(camera);
+    }
+}
+
+// =============================================================================
+// Watch Shaders
+// =============================================================================
+#ifndef RTS_HEADLESS
+void ChunkManager::watchShaders(ShaderWatcher& watcher) {
+    watcher.watch(renderer.getShader());
+    watcher.watch(lod.getShader());
+}
+#endif
+
+// =============================================================================
+// Get Chunk Position At
+// =============================================================================
+vec2i_t ChunkManager::getChunkPositionAt(vec3f_t pos) {
+    vec2i_t chunkPos;
+    chunkPos.x = getChunkCoordX(pos.x);
+    chunkPos.y = getChunkCoordY(pos.y);
+    return chunkPos;
 }
 
 #endif // CHUNK_MANAGER_H
\ No newline at end of file
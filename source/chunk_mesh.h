@@ -0,0 +1,122 @@
+#ifndef CHUNK_MESH_H
+#define CHUNK_MESH_H
+
+// local includes
+#include "types.h"
+#include "chunk.h"
+#include "chunk_renderer.h"
+
+// STL includes
+#include <cstdint>
+
+// =============================================================================
+// ChunkMesh Class
+// =============================================================================
+// Render side of a chunk.  Owns one ChunkRenderer slot, so it is move-only
+// and only created for chunks that are drawn.  The GPU only receives the
+// tile ids and autotile variants; chunk_vert.glsl pulls each tile from the
+// slot and derives the quad corners and atlas coordinates from gl_VertexID
+// and gl_InstanceID.
+class ChunkMesh {
+    public:
+        ChunkMesh(ChunkRenderer& renderer);
+        ~ChunkMesh();
+        ChunkMesh(const ChunkMesh&) = delete;
+        ChunkMesh& operator=(const ChunkMesh&) = delete;
+        ChunkMesh(ChunkMesh&& other) noexcept;
+        ChunkMesh& operator=(ChunkMesh&& other) noexcept;
+        void updatePosition(int x, int y);
+        void updateTiles(const TileArray2D& tiles, const TileArray2D& variants);
+        void updateTiles(const TileArray2D& tiles, const TileArray2D& variants, TileRect rect);
+        vec2i_t getPosition() const { return pos; };
+
+        TileRect dirtyRect; // tiles to re-mask and upload
+
+    private:
+        void release();
+
+        ChunkRenderer* renderer = nullptr;
+        int slot = -1;
+        vec2i_t pos;
+};
+
+// =============================================================================
+// Construct ChunkMesh
+// =============================================================================
+ChunkMesh::ChunkMesh(ChunkRenderer& renderer) {
+
+    pos.x = 0;
+    pos.y = 0;
+
+    this->renderer = &renderer;
+    slot = renderer.allocateSlot();
+}
+
+// =============================================================================
+// Destruct ChunkMesh
+// =============================================================================
+ChunkMesh::~ChunkMesh() {
+    release();
+}
+
+// =============================================================================
+// Move Construct ChunkMesh
+// =============================================================================
+ChunkMesh::ChunkMesh(ChunkMesh&& other) noexcept
+        : dirtyRect(other.dirtyRect),
+          renderer(other.renderer),
+          slot(other.slot),
+          pos(other.pos) {
+    other.slot = -1;
+}
+
+// =============================================================================
+// Move Assign ChunkMesh
+// =============================================================================
+ChunkMesh& ChunkMesh::operator=(ChunkMesh&& other) noexcept {
+    if (this != &other) {
+        release();
+        renderer = other.renderer;
+        slot = other.slot;
+        pos = other.pos;
+        dirtyRect = other.dirtyRect;
+        other.slot = -1;
+    }
+    return *this;
+}
+
+// =============================================================================
+// Release Render Slot
+// =============================================================================
+void ChunkMesh::release() {
+    if (renderer != nullptr && slot >= 0) {
+        renderer->freeSlot(slot);
+    }
+    slot = -1;
+}
+
+// =============================================================================
+// Update Chunk Position
+// =============================================================================
+void ChunkMesh::updatePosition(int x, int y) {
+    pos.x = x;
+    pos.y = y;
+    renderer->uploadPosition(slot, x, y);
+}
+
+// =============================================================================
+// Update Chunk Tiles
+// =============================================================================
+void ChunkMesh::updateTiles(const TileArray2D& tiles, const TileArray2D& variants) {
+    renderer->uploadTiles(slot, tiles, variants);
+}
+
+// =============================================================================
+// Update Chunk Tiles
+// =============================================================================
+// Uploads only the tiles inside rect.
+void ChunkMesh::updateTiles(const TileArray2D& tiles, const TileArray2D& variants, TileRect rect) {
+    renderer->uploadTiles(slot, tiles, variants, rect);
+}
+
+#endif // CHUNK_MESH_H
\ No newline at end of file
@@ -0,0 +1,438 @@
+#ifndef CHUNK_RENDERER_H
+#define CHUNK_RENDERER_H
+
+// local includes
+#include "types.h"
+#ifndef RTS_HEADLESS
+#include "shader.h"
+#endif
+#include "camera.h"
+#include "chunk.h"
+#include "chunk_atlas.h"
+#include "autotile.h"
+
+/// third party includes
+#include <GL/glew.h>
+
+// STL includes
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+
+// definitions
+#define TILE_VERTICIES 6
+#define CHUNK_BUFFER_SIZE (CHUNK_TILES * sizeof(std::uint16_t)) // tile id and autotile variant
+#define CHUNK_VERT_SHADER_FILEPATH "D:/_projects/rts-engine/resources/shaders/chunk_vert.glsl"
+#define CHUNK_FRAG_SHADER_FILEPATH "D:/_projects/rts-engine/resources/shaders/chunk_frag.glsl"
+
+// binding points (must match chunk_vert.glsl)
+#define CHUNK_CAMERA_UBO_BINDING 0
+#define CHUNK_TILES_SSBO_BINDING 0
+#define CHUNK_POSITIONS_SSBO_BINDING 1
+
+// =============================================================================
+// ChunkRenderer Class
+// =============================================================================
+// Draws every resident chunk with a single glMultiDrawArraysIndirect.  Tile
+// ids of all chunks live in one persistently mapped storage buffer split
+// into fixed size slots; ChunkMesh owns one slot per drawn chunk.  Each
+// indirect command draws TILE_VERTICIES vertices for CHUNK_TILES instances
+// and passes the slot through baseInstance (gl_BaseInstance in the shader).
+//
+// Each tile is 16 bits: the id in the low byte and its autotile variant in
+// the high byte.  Variants only pick the atlas layer when the atlas holds a
+// full blob set per tile type; otherwise the layer of the id is drawn.
+class ChunkRenderer {
+    public:
+        ChunkRenderer() {};
+        ~ChunkRenderer();
+        ChunkRenderer(const ChunkRenderer&) = delete;
+        ChunkRenderer& operator=(const ChunkRenderer&) = delete;
+        void init(int numSlots);
+        int allocateSlot();
+        void freeSlot(int slot);
+        void uploadPosition(int slot, int x, int y);
+        void uploadTiles(int slot, const TileArray2D& tiles, const TileArray2D& variants);
+        void uploadTiles(int slot, const TileArray2D& tiles, const TileArray2D& variants, TileRect rect);
+        void render(Camera& camera);
+        void endFrame();
+        const ChunkAtlas& getAtlas() { return atlas; };
+        int getNumSlots() { return numSlots; };
+        int getNumUsedSlots() { return numUsedSlots; };
+        int getNumDrawnSlots() { return int(commands.size()); };
+#ifndef RTS_HEADLESS
+        Shader& getShader() { return shader; };
+#endif
+
+    private:
+        struct DrawCommand {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint first;
+            GLuint baseInstance;
+        };
+
+        struct RetiredSlots {
+            GLsync fence;
+            std::vector<int> slots;
+        };
+
+        void reclaimSlots();
+        void setupUniforms();
+
+        bool isInitialized = false;
+        bool isCommandsDirty = true;
+        int numSlots = 0;
+        int numUsedSlots = 0;
+
+        std::vector<bool> slotsUsed;
+        std::vector<vec2i_t> slotPositions; // host copy for culling
+        vec2i_t visibleMin; // visible chunk range the commands were built for
+        vec2i_t visibleMax;
+        std::vector<int> freeSlots;
+        std::vector<int> pendingSlots;
+        std::deque<RetiredSlots> retiredSlots;
+        std::vector<DrawCommand> commands;
+
+        std::uint16_t* tilesMap = nullptr;
+        GLint* positionsMap = nullptr;
+        ChunkAtlas atlas;
+#ifdef RTS_HEADLESS
+        std::vector<std::uint16_t> tilesHost;
+        std::vector<GLint> positionsHost;
+#else
+        Shader shader;
+        int shaderRevision = 0; // revision the uniforms were last set for
+#endif
+
+        GLuint vaoId = 0;
+        GLuint cameraUboId = 0;
+        GLuint tilesSsboId = 0;
+        GLuint positionsSsboId = 0;
+        GLuint commandsBufferId = 0;
+};
+
+// =============================================================================
+// Destruct ChunkRenderer
+// =============================================================================
+ChunkRenderer::~ChunkRenderer() {
+#ifndef RTS_HEADLESS
+    if (!isInitialized) {
+        return;
+    }
+
+    for (RetiredSlots& r : retiredSlots) {
+        glDeleteSync(r.fence);
+    }
+
+    glDeleteBuffers(1, &cameraUboId);
+    glDeleteBuffers(1, &tilesSsboId);
+    glDeleteBuffers(1, &positionsSsboId);
+    glDeleteBuffers(1, &commandsBufferId);
+    glDeleteVertexArrays(1, &vaoId);
+#endif
+}
+
+// =============================================================================
+// Initialize
+// =============================================================================
+void ChunkRenderer::init(int numSlots) {
+
+    this->numSlots = numSlots;
+    slotsUsed.assign(numSlots, false);
+    slotPositions.assign(numSlots, vec2i_t());
+    visibleMin.x = 0;
+    visibleMin.y = 0;
+    visibleMax.x = -1;
+    visibleMax.y = -1;
+    commands.reserve(numSlots);
+
+    // hand out low slots first
+    freeSlots.clear();
+    for (int s = numSlots - 1; s >= 0; s--) {
+        freeSlots.push_back(s);
+    }
+
+    // tile colors are needed even without a context
+    atlas.init();
+
+#ifdef RTS_HEADLESS
+    tilesHost.assign(size_t(numSlots) * CHUNK_TILES, 0);
+    positionsHost.assign(size_t(numSlots) * 2, 0);
+    tilesMap = tilesHost.data();
+    positionsMap = positionsHost.data();
+#else
+    // setup shader
+    shader = Shader(
+        std::string(CHUNK_VERT_SHADER_FILEPATH),
+        std::string(CHUNK_FRAG_SHADER_FILEPATH)
+    );
+    setupUniforms();
+
+    // core profile requires a vertex array even though there are no attributes
+    glGenVertexArrays(1, &vaoId);
+
+    // setup persistently mapped slot storage
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLsizeiptr tilesSize = GLsizeiptr(numSlots) * CHUNK_BUFFER_SIZE;
+    GLsizeiptr positionsSize = GLsizeiptr(numSlots) * 2 * sizeof(GLint);
+
+    glGenBuffers(1, &tilesSsboId);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, tilesSsboId);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, tilesSize, nullptr, flags);
+    tilesMap = (std::uint16_t*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, tilesSize, flags);
+
+    glGenBuffers(1, &positionsSsboId);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, positionsSsboId);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, positionsSize, nullptr, flags);
+    positionsMap = (GLint*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, positionsSize, flags);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // setup camera uniform buffer (projection and view matrices)
+    glGenBuffers(1, &cameraUboId);
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraUboId);
+    glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(mat4x4f_t), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // setup indirect draw command buffer
+    glGenBuffers(1, &commandsBufferId);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandsBufferId);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, numSlots * sizeof(DrawCommand), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    if (tilesMap == nullptr || positionsMap == nullptr) {
+        std::cout << "ERROR: chunk slot buffers could not be mapped." << std::endl;
+        exit(1);
+    }
+#endif
+
+    isInitialized = true;
+}
+
+// =============================================================================
+// Allocate Slot
+// =============================================================================
+int ChunkRenderer::allocateSlot() {
+
+    if (freeSlots.empty()) {
+        reclaimSlots();
+    }
+
+    if (freeSlots.empty()) {
+        std::cout << "WARNING: out of chunk render slots" << std::endl;
+        return -1;
+    }
+
+    int slot = freeSlots.back();
+    freeSlots.pop_back();
+    slotsUsed[slot] = true;
+    numUsedSlots++;
+    isCommandsDirty = true;
+    return slot;
+}
+
+// =============================================================================
+// Free Slot
+// =============================================================================
+void ChunkRenderer::freeSlot(int slot) {
+
+    if (slot < 0 || !slotsUsed[slot]) {
+        return;
+    }
+
+    // frames still in flight may read this slot, so it is only reused once
+    // the fence of the current frame has signaled
+    slotsUsed[slot] = false;
+    pendingSlots.push_back(slot);
+    numUsedSlots--;
+    isCommandsDirty = true;
+}
+
+// =============================================================================
+// Upload Position
+// =============================================================================
+void ChunkRenderer::uploadPosition(int slot, int x, int y) {
+    if (slot < 0) {
+        return;
+    }
+    positionsMap[slot * 2 + 0] = x;
+    positionsMap[slot * 2 + 1] = y;
+    slotPositions[slot].x = x;
+    slotPositions[slot].y = y;
+    isCommandsDirty = true;
+}
+
+// =============================================================================
+// Upload Tiles
+// =============================================================================
+void ChunkRenderer::uploadTiles(int slot, const TileArray2D& tiles, const TileArray2D& variants) {
+    if (slot < 0) {
+        return;
+    }
+
+    // interleave into a local copy so the mapped buffer sees one linear write
+    const std::uint8_t* ids = &tiles[0][0];
+    const std::uint8_t* vars = &variants[0][0];
+    std::uint16_t words[CHUNK_TILES];
+    for (int i = 0; i < CHUNK_TILES; i++) {
+        words[i] = std::uint16_t(ids[i] | (vars[i] << 8));
+    }
+    std::memcpy(tilesMap + size_t(slot) * CHUNK_TILES, words, CHUNK_BUFFER_SIZE);
+}
+
+// =============================================================================
+// Upload Tiles
+// =============================================================================
+// Writes only the tiles inside rect.  The slot storage is persistently
+// mapped, so this is one row span per rect row and no buffer respecification.
+void ChunkRenderer::uploadTiles(int slot, const TileArray2D& tiles, const TileArray2D& variants, TileRect rect) {
+    if (slot < 0 || rect.isEmpty()) {
+        return;
+    }
+
+    std::uint16_t row[CHUNK_TILES_X];
+    int width = rect.getWidth();
+    for (int y = rect.minY; y <= rect.maxY; y++) {
+        for (int x = rect.minX; x <= rect.maxX; x++) {
+            row[x - rect.minX] = std::uint16_t(tiles[y][x] | (variants[y][x] << 8));
+        }
+        std::memcpy(tilesMap + size_t(slot) * CHUNK_TILES + y * CHUNK_TILES_X + rect.minX,
+            row, size_t(width) * sizeof(std::uint16_t));
+    }
+}
+
+// =============================================================================
+// Reclaim Slots
+// =============================================================================
+void ChunkRenderer::reclaimSlots() {
+#ifdef RTS_HEADLESS
+    freeSlots.insert(freeSlots.end(), pendingSlots.begin(), pendingSlots.end());
+    pendingSlots.clear();
+#else
+    while (!retiredSlots.empty()) {
+        RetiredSlots& r = retiredSlots.front();
+        GLenum status = glClientWaitSync(r.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+
+        freeSlots.insert(freeSlots.end(), r.slots.begin(), r.slots.end());
+        glDeleteSync(r.fence);
+        retiredSlots.pop_front();
+    }
+#endif
+}
+
+// =============================================================================
+// Setup Uniforms
+// =============================================================================
+void ChunkRenderer::setupUniforms() {
+#ifndef RTS_HEADLESS
+    // variants select layers only if every tile type has a full blob set
+    bool hasBlobSets = atlas.getNumLayers() >= TILE_TYPES * AUTOTILE_VARIANTS;
+    shader.setUniform("autotileStride", GLint(hasBlobSets ? AUTOTILE_VARIANTS : 0));
+    shaderRevision = shader.getRevision();
+#endif
+}
+
+// =============================================================================
+// Render
+// =============================================================================
+void ChunkRenderer::render(Camera& camera) {
+
+    reclaimSlots();
+
+    // chunks overlapping the visible rectangle
+    vec2f_t viewMin, viewMax;
+    camera.getViewBounds(viewMin, viewMax);
+
+    vec2i_t chunkMin, chunkMax;
+    chunkMin.x = getChunkCoordX(viewMin.x);
+    chunkMin.y = getChunkCoordY(viewMin.y);
+    chunkMax.x = getChunkCoordX(viewMax.x);
+    chunkMax.y = getChunkCoordY(viewMax.y);
+
+    if (chunkMin.x != visibleMin.x || chunkMin.y != visibleMin.y ||
+        chunkMax.x != visibleMax.x || chunkMax.y != visibleMax.y) {
+        visibleMin = chunkMin;
+        visibleMax = chunkMax;
+        isCommandsDirty = true;
+    }
+
+    // rebuild draw commands only when the used slots or the visible chunks
+    // changed, skipping slots outside the view
+    if (isCommandsDirty) {
+        commands.clear();
+        for (int s = 0; s < numSlots; s++) {
+            vec2i_t pos = slotPositions[s];
+            if (slotsUsed[s] &&
+                pos.x >= visibleMin.x && pos.x <= visibleMax.x &&
+                pos.y >= visibleMin.y && pos.y <= visibleMax.y) {
+                commands.push_back({TILE_VERTICIES, CHUNK_TILES, 0, GLuint(s)});
+            }
+        }
+    }
+
+#ifndef RTS_HEADLESS
+    if (isCommandsDirty) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandsBufferId);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawCommand), commands.data());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    // upload camera matrices once per frame
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraUboId);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(mat4x4f_t), &camera.projMat.flat[0]);
+    glBufferSubData(GL_UNIFORM_BUFFER, sizeof(mat4x4f_t), sizeof(mat4x4f_t), &camera.viewMat.flat[0]);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // a reloaded program starts with default uniforms
+    if (shader.getRevision() != shaderRevision) {
+        setupUniforms();
+    }
+
+    // bind OpenGL objects
+    glUseProgram(shader.getProgId());
+    glBindVertexArray(vaoId);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas.getTextureId());
+    glBindBufferBase(GL_UNIFORM_BUFFER, CHUNK_CAMERA_UBO_BINDING, cameraUboId);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CHUNK_TILES_SSBO_BINDING, tilesSsboId);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CHUNK_POSITIONS_SSBO_BINDING, positionsSsboId);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandsBufferId);
+
+    // render every chunk with one draw call
+    glMultiDrawArraysIndirect(GL_TRIANGLES, nullptr, GLsizei(commands.size()), 0);
+
+    // unbind OpenGL objects
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+#endif
+
+    isCommandsDirty = false;
+    endFrame();
+}
+
+// =============================================================================
+// End Frame
+// =============================================================================
+// Retires slots freed this frame.  Called by render(), or directly on frames
+// that draw no chunks so freed slots still come back.
+void ChunkRenderer::endFrame() {
+#ifndef RTS_HEADLESS
+    // slots freed this frame are safe to reuse once this frame completes
+    if (!pendingSlots.empty()) {
+        RetiredSlots r;
+        r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        r.slots.swap(pendingSlots);
+        retiredSlots.push_back(std::move(r));
+    }
+#endif
+}
+
+#endif // CHUNK_RENDERER_H
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 // local includes
 #include "types.h"
+#include "asset_cache.h"
+#include "shader.h"
 
 // third party includes
 // #include "SDL_ttf.h"
@@ -12,9 +14,23 @@
 // STL includes
 #include <iostream>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
 
 // definitions
 #define FONT_FILEPATH "D:/_projects/rts-engine/resources/fonts/MONOFONT.TTF"
+#define FONT_PIXEL_SIZE 32
+#define FONT_CHAR_BEG 32 // first character in the glyph atlas
+#define FONT_CHAR_END 128 // one past the last
+#define FONT_CACHE_NAME "debug_font"
+#define DEBUG_VERT_SHADER_FILEPATH "D:/_projects/rts-engine/resources/shaders/debug_vert.glsl"
+#define DEBUG_FRAG_SHADER_FILEPATH "D:/_projects/rts-engine/resources/shaders/debug_frag.glsl"
+#define DEBUG_SCREEN_MARGIN 8 // pixels between the text and the screen edge
+#define DEBUG_SCREEN_MAX_GLYPHS 16384 // glyphs drawn per frame
+#define DEBUG_SCREEN_BUFFERS 3 // frames in flight in the glyph buffer
+#define DEBUG_GLYPHS_SSBO_BINDING 3 // must match debug_vert.glsl
 
 // https://en.wikibooks.org/wiki/OpenGL_Programming/Modern_OpenGL_Tutorial_Text_Rendering_01
 // https://en.wikibooks.org/wiki/OpenGL_Programming/Modern_OpenGL_Tutorial_Text_Rendering_02
@@ -22,17 +38,55 @@
 // =============================================================================
 // Chunk Class
 // =============================================================================
+// The glyph atlas is rasterized once per font file and kept in the asset
+// cache; later starts map it and skip FreeType entirely.
+//
+// Text is printed line by line each frame and drawn top left over the scene
+// in a single instanced draw, one instance per glyph.  Glyph quads are pulled
+// from a persistently mapped storage buffer split into DEBUG_SCREEN_BUFFERS
+// regions fenced per frame.  Each printed line keeps its layout and is only
+// laid out again when its text differs from the previous frame's line.
 class DebugScreen {
     public:
         DebugScreen() {};
-        void init();
+        ~DebugScreen();
+        DebugScreen(const DebugScreen&) = delete;
+        DebugScreen& operator=(const DebugScreen&) = delete;
+        void init(int screenX, int screenY);
+        void clear() { numLines = 0; };
+        void print(const std::string& text);
         void render();
+        Shader& getShader() { return shader; };
     
     private:
-        FT_GlyphSlot gs;
-        unsigned int w;
-        unsigned int h;
+        // screen rectangle and atlas rectangle, as read by debug_vert.glsl
+        struct Glyph {
+            float x0, y0, x1, y1;
+            float u0, v0, u1, v1;
+        };
+
+        struct Line {
+            std::string text;
+            std::vector<Glyph> glyphs;
+        };
+
+        bool rasterize(std::vector<std::uint8_t>& blob);
+        void layoutLine(Line& line, float x, float y);
+
+        bool isInitialized = false;
+        int screenX = 0;
+        int screenY = 0;
+        unsigned int w = 0;
+        unsigned int h = 0;
         GLuint textureId = 0;
+        GLuint vaoId = 0;
+        GLuint glyphsSsboId = 0;
+        Glyph* glyphsMap = nullptr;
+        GLsync fences[DEBUG_SCREEN_BUFFERS] = {};
+        int bufferIndex = 0;
+        Shader shader;
+        std::vector<Line> lines; // layouts kept across frames
+        size_t numLines = 0; // lines printed this frame
 
         struct charInfo {
             float ax; // advance.x
@@ -45,10 +99,107 @@ class DebugScreen {
         } c[128];
 };
 
+// =============================================================================
+// Destruct DebugScreen
+// =============================================================================
+DebugScreen::~DebugScreen() {
+    if (!isInitialized) {
+        return;
+    }
+    for (GLsync fence : fences) {
+        if (fence != nullptr) {
+            glDeleteSync(fence);
+        }
+    }
+    glDeleteBuffers(1, &glyphsSsboId);
+    glDeleteVertexArrays(1, &vaoId);
+    glDeleteTextures(1, &textureId);
+}
+
 // =============================================================================
 // Initialize
 // =============================================================================
-void DebugScreen::init() {
+void DebugScreen::init(int screenX, int screenY) {
+
+    this->screenX = screenX;
+    this->screenY = screenY;
+
+    // blob: width, height, glyph metrics, then the atlas pixels
+    const std::uint32_t layout[3] = {FONT_PIXEL_SIZE, FONT_CHAR_BEG, FONT_CHAR_END};
+    std::uint64_t key = AssetCache::hash(layout, sizeof(layout));
+    bool hasSource = AssetCache::hashFile(FONT_FILEPATH, key);
+
+    AssetCache cache;
+    AssetBlob blob;
+    std::vector<std::uint8_t> rasterized;
+    const std::uint8_t* pixels = nullptr;
+    const size_t metricsSize = 2 * sizeof(std::uint32_t) + sizeof(c);
+
+    if (hasSource && cache.load(FONT_CACHE_NAME, key, blob) && blob.getSize() >= metricsSize) {
+        std::uint32_t size[2];
+        std::memcpy(size, blob.getData(), sizeof(size));
+        if (blob.getSize() == metricsSize + size_t(size[0]) * size[1]) {
+            w = size[0];
+            h = size[1];
+            std::memcpy(c, blob.getData() + sizeof(size), sizeof(c));
+            pixels = blob.getData() + metricsSize;
+        }
+    }
+
+    if (pixels == nullptr) {
+        if (!rasterize(rasterized)) {
+            exit(1);
+        }
+        pixels = rasterized.data() + metricsSize;
+        cache.store(FONT_CACHE_NAME, key, rasterized.data(), rasterized.size());
+    }
+
+    // setup the texture atlas
+    glActiveTexture(GL_TEXTURE0);
+    glGenTextures(1, &textureId);
+    glBindTexture(GL_TEXTURE_2D, textureId);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(
+        GL_TEXTURE_2D,
+        0,
+        GL_R8,
+        w,
+        h,
+        0,
+        GL_RED,
+        GL_UNSIGNED_BYTE,
+        pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // setup shader
+    shader = Shader(
+        std::string(DEBUG_VERT_SHADER_FILEPATH),
+        std::string(DEBUG_FRAG_SHADER_FILEPATH)
+    );
+
+    // core profile requires a vertex array even though there are no attributes
+    glCreateVertexArrays(1, &vaoId);
+
+    // setup persistently mapped glyph storage, one region per frame in flight
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLsizeiptr glyphsSize = GLsizeiptr(DEBUG_SCREEN_BUFFERS) * DEBUG_SCREEN_MAX_GLYPHS * sizeof(Glyph);
+    glCreateBuffers(1, &glyphsSsboId);
+    glNamedBufferStorage(glyphsSsboId, glyphsSize, nullptr, flags);
+    glyphsMap = (Glyph*)glMapNamedBufferRange(glyphsSsboId, 0, glyphsSize, flags);
+
+    isInitialized = true;
+}
+
+// =============================================================================
+// Rasterize
+// =============================================================================
+// Renders every glyph with FreeType in a single pass and packs them side by
+// side, laid out as the cache blob.
+bool DebugScreen::rasterize(std::vector<std::uint8_t>& blob) {
 
     FT_Error err;
 
@@ -57,7 +208,7 @@ void DebugScreen::init() {
     err = FT_Init_FreeType(&ft);
     if (err) {
         std::cout << "ERROR: Could not init freetype library" << std::endl;
-        exit(1);
+        return false;
     }
 
     // load the font
@@ -65,77 +216,171 @@ void DebugScreen::init() {
     err = FT_New_Face(ft, FONT_FILEPATH, 0, &face);
     if (err) {
         std::cout << "ERROR: Could not open font" << std::endl;
-        exit(1);
+        FT_Done_FreeType(ft);
+        return false;
     }
-    gs = face->glyph;
+    FT_GlyphSlot gs = face->glyph;
 
     // set the font size
-    err = FT_Set_Pixel_Sizes(face, 0, 32);
+    err = FT_Set_Pixel_Sizes(face, 0, FONT_PIXEL_SIZE);
 
-    // load the font characters for the font atlas
-    for (int i = 32; i < 128; i++) {
+    // render the glyphs, keeping their bitmaps until the atlas size is known
+    std::vector<std::uint8_t> bitmaps[FONT_CHAR_END];
+    std::memset(c, 0, sizeof(c));
+    w = 0;
+    h = 0;
+    for (int i = FONT_CHAR_BEG; i < FONT_CHAR_END; i++) {
         err = FT_Load_Char(face, i, FT_LOAD_RENDER);
         if(err) {
             std::cout << "WARNING: Loading character " << char(i) << "failed" << std::endl;
             continue;
         }
 
-        w += gs->bitmap.width;
-        h = std::max(h, gs->bitmap.rows);
+        unsigned int bw = gs->bitmap.width;
+        unsigned int bh = gs->bitmap.rows;
+        bitmaps[i].resize(size_t(bw) * bh);
+        for (unsigned int y = 0; y < bh; y++) {
+            std::memcpy(bitmaps[i].data() + size_t(y) * bw, gs->bitmap.buffer + y * gs->bitmap.pitch, bw);
+        }
+
+        c[i].ax = gs->advance.x >> 6;
+        c[i].ay = gs->advance.y >> 6;
+        c[i].bw = bw;
+        c[i].bh = bh;
+        c[i].bl = gs->bitmap_left;
+        c[i].bt = gs->bitmap_top;
+        c[i].tx = float(w); // converted to texture coordinates below
+
+        w += bw;
+        h = std::max(h, bh);
     }
 
-    // setup the texture atlas
-    glActiveTexture(GL_TEXTURE0);
-    glGenTextures(1, &textureId);
-    glBindTexture(GL_TEXTURE_2D, textureId);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glTexImage2D(
-        GL_TEXTURE_2D,
-        0,
-        GL_RED,
-        w,
-        h,
-        0,
-        GL_ALPHA,
-        GL_UNSIGNED_BYTE,
-        0);
+    FT_Done_Face(face);
+    FT_Done_FreeType(ft);
 
-    // load glyph images into the texture atlas
-    int x = 0;
-    for(int i = 32; i < 128; i++) {
-        err = FT_Load_Char(face, i, FT_LOAD_RENDER);
-        if(err) {
-            continue;
+    // pack the glyphs into the atlas after the metrics
+    const size_t metricsSize = 2 * sizeof(std::uint32_t) + sizeof(c);
+    blob.assign(metricsSize + size_t(w) * h, 0);
+    std::uint8_t* pixels = blob.data() + metricsSize;
+    for (int i = FONT_CHAR_BEG; i < FONT_CHAR_END; i++) {
+        unsigned int x = (unsigned int)c[i].tx;
+        unsigned int bw = (unsigned int)c[i].bw;
+        for (unsigned int y = 0; y < (unsigned int)c[i].bh; y++) {
+            std::memcpy(pixels + size_t(y) * w + x, bitmaps[i].data() + size_t(y) * bw, bw);
         }
+        c[i].tx = w > 0 ? c[i].tx / float(w) : 0.0f;
+    }
 
-        glTexSubImage2D(
-            GL_TEXTURE_2D,
-            0,
-            x,
-            0,
-            gs->bitmap.width,
-            gs->bitmap.rows,
-            GL_ALPHA,
-            GL_UNSIGNED_BYTE,
-            gs->bitmap.buffer);
+    std::uint32_t size[2] = {w, h};
+    std::memcpy(blob.data(), size, sizeof(size));
+    std::memcpy(blob.data() + sizeof(size), c, sizeof(c));
+    return true;
+}
 
-        x += gs->bitmap.width;
+// =============================================================================
+// Print
+// =============================================================================
+// Adds a line below the previous one.  Unchanged lines reuse their layout.
+void DebugScreen::print(const std::string& text) {
+    if (numLines == lines.size()) {
+        lines.emplace_back();
+    }
 
-        c[i].ax = gs->advance.x >> 6;
-        c[i].ay = gs->advance.y >> 6;
-        c[i].bw = gs->bitmap.width;
-        c[i].bh = gs->bitmap.rows;
-        c[i].bl = gs->bitmap_left;
-        c[i].bt = gs->bitmap_top;
-        c[i].tx = (float)x / w;
+    Line& line = lines[numLines];
+    if (line.text != text) {
+        line.text = text;
+        layoutLine(line, DEBUG_SCREEN_MARGIN, DEBUG_SCREEN_MARGIN + float(numLines) * FONT_PIXEL_SIZE);
     }
+    numLines++;
 }
 
 // =============================================================================
 // Render
 // =============================================================================
 void DebugScreen::render() {
+    if (!isInitialized || numLines == 0) {
+        return;
+    }
+
+    // wait until the gpu is done with the region written three frames ago
+    GLsync& fence = fences[bufferIndex];
+    if (fence != nullptr) {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    // gather every line into this frame's region
+    GLuint first = GLuint(bufferIndex) * DEBUG_SCREEN_MAX_GLYPHS;
+    Glyph* region = glyphsMap + first;
+    size_t numGlyphs = 0;
+    for (size_t l = 0; l < numLines; l++) {
+        const std::vector<Glyph>& glyphs = lines[l].glyphs;
+        size_t n = std::min(glyphs.size(), size_t(DEBUG_SCREEN_MAX_GLYPHS) - numGlyphs);
+        std::memcpy(region + numGlyphs, glyphs.data(), n * sizeof(Glyph));
+        numGlyphs += n;
+    }
+    if (numGlyphs == 0) {
+        return;
+    }
+
+    // uniforms are set every frame so a reloaded program needs nothing else
+    vec2f_t screenSize = {{float(screenX), float(screenY)}};
+    vec3f_t textColor = {{1.0f, 1.0f, 1.0f}};
+    shader.setUniform("screenSize", screenSize);
+    shader.setUniform("textColor", textColor);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(shader.getProgId());
+    glBindVertexArray(vaoId);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textureId);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DEBUG_GLYPHS_SSBO_BINDING, glyphsSsboId);
+
+    // every glyph of the frame in one draw, the region start in baseInstance
+    glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 6, GLsizei(numGlyphs), first);
+
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    bufferIndex = (bufferIndex + 1) % DEBUG_SCREEN_BUFFERS;
 
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glDisable(GL_BLEND);
+}
+
+// =============================================================================
+// Layout Line
+// =============================================================================
+// One glyph per visible character, x and y being the top left corner of the
+// line in pixels.
+void DebugScreen::layoutLine(Line& line, float x, float y) {
+
+    line.glyphs.clear();
+    float baseline = y + FONT_PIXEL_SIZE;
+
+    for (char ch : line.text) {
+        int i = (unsigned char)ch;
+        if (i < FONT_CHAR_BEG || i >= FONT_CHAR_END) {
+            continue;
+        }
+
+        Glyph glyph;
+        glyph.x0 = x + c[i].bl;
+        glyph.y0 = baseline - c[i].bt;
+        glyph.x1 = glyph.x0 + c[i].bw;
+        glyph.y1 = glyph.y0 + c[i].bh;
+        glyph.u0 = c[i].tx;
+        glyph.v0 = 0.0f;
+        glyph.u1 = c[i].tx + c[i].bw / float(w);
+        glyph.v1 = c[i].bh / float(h);
+        x += c[i].ax;
+
+        if (c[i].bw > 0 && c[i].bh > 0) {
+            line.glyphs.push_back(glyph);
+        }
+    }
 }
 
 #endif // DEBUG_SCREEN_H
\ No newline at end of file
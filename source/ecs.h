@@ -0,0 +1,454 @@
+#ifndef ECS_H
+#define ECS_H
+
+// STL includes
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// definitions
+#define ECS_MAX_COMPONENTS 64 // one bit each in a ComponentMask
+#define ECS_CHUNK_ENTITIES 1024 // entities per archetype chunk
+#define ECS_COLUMN_ALIGNMENT 64 // every column starts on a cache line
+#define ECS_NULL_INDEX 0xFFFFFFFFu
+
+typedef std::uint64_t ComponentMask;
+
+// =============================================================================
+// Entity Struct
+// =============================================================================
+// Index into the world's entity records plus the generation of that record
+// when the entity was created.  Destroying an entity bumps the generation, so
+// stale handles are detected even after the index is reused.
+struct Entity {
+    std::uint32_t index = ECS_NULL_INDEX;
+    std::uint32_t generation = 0;
+
+    bool isNull() const { return index == ECS_NULL_INDEX; };
+    bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; };
+    bool operator!=(const Entity& other) const { return !(*this == other); };
+};
+
+// =============================================================================
+// Component Types
+// =============================================================================
+// Components are plain structs, moved between archetypes with memcpy.  Each
+// type gets a small id the first time it is used.
+struct ComponentInfo {
+    size_t size;
+    size_t alignment;
+};
+
+inline std::vector<ComponentInfo>& getComponentInfos() {
+    static std::vector<ComponentInfo> infos;
+    return infos;
+}
+
+inline int registerComponent(size_t size, size_t alignment) {
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<ComponentInfo>& infos = getComponentInfos();
+    if (infos.size() >= ECS_MAX_COMPONENTS) {
+        std::cout << "ERROR: more than " << ECS_MAX_COMPONENTS << " component types" << std::endl;
+        exit(1);
+    }
+    infos.push_back({size, alignment});
+    return int(infos.size()) - 1;
+}
+
+template <typename T>
+int getComponentId() {
+    static_assert(std::is_trivially_copyable<T>::value, "components must be trivially copyable");
+    static_assert(alignof(T) <= ECS_COLUMN_ALIGNMENT, "component alignment exceeds a column");
+    static const int id = registerComponent(sizeof(T), alignof(T));
+    return id;
+}
+
+template <typename... Ts>
+ComponentMask getComponentMask() {
+    return (ComponentMask(0) | ... | (ComponentMask(1) << getComponentId<Ts>()));
+}
+
+// =============================================================================
+// Archetype Class
+// =============================================================================
+// Storage of every entity with exactly one set of components.  Entities are
+// packed into fixed size chunks; each chunk is one allocation holding the
+// entity handles followed by one contiguous array per component, so systems
+// stream through each component linearly.  Rows stay dense: removing one
+// moves the archetype's last row into the hole.
+class Archetype {
+    public:
+        struct Chunk {
+            struct Free { void operator()(std::uint8_t* p) { ::operator delete(p, std::align_val_t(ECS_COLUMN_ALIGNMENT)); }; };
+
+            std::unique_ptr<std::uint8_t, Free> block;
+            int numEntities = 0;
+        };
+
+        Archetype(ComponentMask mask);
+        ComponentMask getMask() const { return mask; };
+        size_t getNumEntities() const { return numEntities; };
+        int getNumChunks() const { return int(chunks.size()); };
+        int getNumEntities(int chunk) const { return chunks[chunk].numEntities; };
+        Entity* getEntities(int chunk) { return (Entity*)chunks[chunk].block.get(); };
+        std::uint8_t* getColumn(int chunk, int componentId);
+        void addRow(Entity entity, int& chunk, int& row);
+        Entity removeRow(int chunk, int row);
+
+    private:
+        ComponentMask mask;
+        size_t numEntities = 0;
+        size_t chunkSize = 0;
+        size_t offsets[ECS_MAX_COMPONENTS]; // column offset in a chunk, by component id
+        std::vector<int> componentIds;
+        std::vector<Chunk> chunks;
+};
+
+// =============================================================================
+// Construct Archetype
+// =============================================================================
+Archetype::Archetype(ComponentMask mask) : mask(mask) {
+    const std::vector<ComponentInfo>& infos = getComponentInfos();
+
+    // entity handles first, then each column on its own cache line
+    size_t offset = sizeof(Entity) * ECS_CHUNK_ENTITIES;
+    for (int id = 0; id < ECS_MAX_COMPONENTS; id++) {
+        offsets[id] = 0;
+        if (!(mask & (ComponentMask(1) << id))) {
+            continue;
+        }
+        offset = (offset + ECS_COLUMN_ALIGNMENT - 1) / ECS_COLUMN_ALIGNMENT * ECS_COLUMN_ALIGNMENT;
+        offsets[id] = offset;
+        offset += infos[id].size * ECS_CHUNK_ENTITIES;
+        componentIds.push_back(id);
+    }
+    chunkSize = offset;
+}
+
+// =============================================================================
+// Get Column
+// =============================================================================
+std::uint8_t* Archetype::getColumn(int chunk, int componentId) {
+    return chunks[chunk].block.get() + offsets[componentId];
+}
+
+// =============================================================================
+// Add Row
+// =============================================================================
+// Appends an entity with uninitialized components.
+void Archetype::addRow(Entity entity, int& chunk, int& row) {
+    if (chunks.empty() || chunks.back().numEntities == ECS_CHUNK_ENTITIES) {
+        chunks.emplace_back();
+        chunks.back().block.reset((std::uint8_t*)::operator new(chunkSize, std::align_val_t(ECS_COLUMN_ALIGNMENT)));
+    }
+
+    chunk = int(chunks.size()) - 1;
+    row = chunks[chunk].numEntities++;
+    getEntities(chunk)[row] = entity;
+    numEntities++;
+}
+
+// =============================================================================
+// Remove Row
+// =============================================================================
+// Returns the entity moved into the row, or a null entity if the row was the
+// last one.
+Entity Archetype::removeRow(int chunk, int row) {
+    const std::vector<ComponentInfo>& infos = getComponentInfos();
+    int lastChunk = int(chunks.size()) - 1;
+    int lastRow = chunks[lastChunk].numEntities - 1;
+
+    Entity moved;
+    if (chunk != lastChunk || row != lastRow) {
+        moved = getEntities(lastChunk)[lastRow];
+        getEntities(chunk)[row] = moved;
+        for (int id : componentIds) {
+            size_t size = infos[id].size;
+            std::memcpy(getColumn(chunk, id) + row * size, getColumn(lastChunk, id) + lastRow * size, size);
+        }
+    }
+
+    numEntities--;
+    if (--chunks[lastChunk].numEntities == 0) {
+        chunks.pop_back();
+    }
+    return moved;
+}
+
+// =============================================================================
+// World Class
+// =============================================================================
+// Entities and their components, grouped into archetypes by component set.
+// Systems run through forEach(), which hands them whole chunks as plain
+// arrays (one per requested component) so their loops are linear in memory
+// and free to vectorize.  Adding or removing a component moves the entity
+// to another archetype.
+//
+// Not thread safe, and entities must not be created, destroyed or change
+// components inside forEach().
+class World {
+    public:
+        World() {};
+        World(const World&) = delete;
+        World& operator=(const World&) = delete;
+
+        template <typename... Ts>
+        Entity create(const Ts&... components);
+        bool destroy(Entity entity);
+        bool isAlive(Entity entity) const;
+
+        template <typename T>
+        T* get(Entity entity);
+        template <typename T>
+        bool add(Entity entity, const T& component);
+        template <typename T>
+        bool remove(Entity entity);
+
+        template <typename... Ts, typename Func>
+        void forEach(Func func);
+
+        void clear();
+        size_t size() const { return numAlive; };
+        int getNumArchetypes() const { return int(archetypes.size()); };
+
+    private:
+        struct Record {
+            int archetype;
+            int chunk;
+            int row;
+            std::uint32_t generation;
+        };
+
+        int getArchetype(ComponentMask mask);
+        Entity allocateEntity();
+        void removeRow(const Record& record);
+        void moveRow(Entity entity, int toArchetype);
+
+        template <typename T>
+        void writeComponent(const Record& record, const T& component);
+
+        std::vector<Record> records;
+        std::vector<std::uint32_t> freeIndices;
+        std::vector<std::unique_ptr<Archetype>> archetypes;
+        std::unordered_map<ComponentMask, int> archetypeIndices;
+        size_t numAlive = 0;
+};
+
+// =============================================================================
+// Create
+// =============================================================================
+template <typename... Ts>
+Entity World::create(const Ts&... components) {
+    Entity entity = allocateEntity();
+    Record& record = records[entity.index];
+    record.archetype = getArchetype(getComponentMask<Ts...>());
+    archetypes[record.archetype]->addRow(entity, record.chunk, record.row);
+    (writeComponent(record, components), ...);
+    return entity;
+}
+
+// =============================================================================
+// Destroy
+// =============================================================================
+bool World::destroy(Entity entity) {
+    if (!isAlive(entity)) {
+        return false;
+    }
+
+    Record& record = records[entity.index];
+    removeRow(record);
+    record.archetype = -1;
+    record.generation++;
+    freeIndices.push_back(entity.index);
+    numAlive--;
+    return true;
+}
+
+// =============================================================================
+// Is Alive
+// =============================================================================
+bool World::isAlive(Entity entity) const {
+    return entity.index < records.size() &&
+           records[entity.index].archetype >= 0 &&
+           records[entity.index].generation == entity.generation;
+}
+
+// =============================================================================
+// Get
+// =============================================================================
+// Returns nullptr if the entity is gone or lacks the component.  The pointer
+// is invalidated by any structural change.
+template <typename T>
+T* World::get(Entity entity) {
+    if (!isAlive(entity)) {
+        return nullptr;
+    }
+
+    const Record& record = records[entity.index];
+    Archetype& archetype = *archetypes[record.archetype];
+    int id = getComponentId<T>();
+    if (!(archetype.getMask() & (ComponentMask(1) << id))) {
+        return nullptr;
+    }
+    return (T*)archetype.getColumn(record.chunk, id) + record.row;
+}
+
+// =============================================================================
+// Add
+// =============================================================================
+// Adds the component, or overwrites it if the entity already has one.
+template <typename T>
+bool World::add(Entity entity, const T& component) {
+    if (!isAlive(entity)) {
+        return false;
+    }
+
+    ComponentMask mask = archetypes[records[entity.index].archetype]->getMask();
+    ComponentMask bit = ComponentMask(1) << getComponentId<T>();
+    if (!(mask & bit)) {
+        moveRow(entity, getArchetype(mask | bit));
+    }
+    writeComponent(records[entity.index], component);
+    return true;
+}
+
+// =============================================================================
+// Remove
+// =============================================================================
+template <typename T>
+bool World::remove(Entity entity) {
+    if (!isAlive(entity)) {
+        return false;
+    }
+
+    ComponentMask mask = archetypes[records[entity.index].archetype]->getMask();
+    ComponentMask bit = ComponentMask(1) << getComponentId<T>();
+    if (!(mask & bit)) {
+        return false;
+    }
+    moveRow(entity, getArchetype(mask & ~bit));
+    return true;
+}
+
+// =============================================================================
+// For Each
+// =============================================================================
+// Calls func(count, entities, components...) once per chunk of every
+// archetype having all of Ts, with one array of count elements per
+// component.
+template <typename... Ts, typename Func>
+void World::forEach(Func func) {
+    ComponentMask mask = getComponentMask<Ts...>();
+
+    for (std::unique_ptr<Archetype>& archetype : archetypes) {
+        if ((archetype->getMask() & mask) != mask) {
+            continue;
+        }
+        for (int c = 0; c < archetype->getNumChunks(); c++) {
+            func(
+                archetype->getNumEntities(c),
+                (const Entity*)archetype->getEntities(c),
+                (Ts*)archetype->getColumn(c, getComponentId<Ts>())...);
+        }
+    }
+}
+
+// =============================================================================
+// Clear
+// =============================================================================
+// Destroys every entity.  Archetypes and component ids are kept.
+void World::clear() {
+    for (std::uint32_t i = 0; i < records.size(); i++) {
+        Entity entity = {i, records[i].generation};
+        destroy(entity);
+    }
+}
+
+// =============================================================================
+// Get Archetype
+// =============================================================================
+int World::getArchetype(ComponentMask mask) {
+    auto it = archetypeIndices.find(mask);
+    if (it != archetypeIndices.end()) {
+        return it->second;
+    }
+
+    archetypes.push_back(std::make_unique<Archetype>(mask));
+    int index = int(archetypes.size()) - 1;
+    archetypeIndices[mask] = index;
+    return index;
+}
+
+// =============================================================================
+// Allocate Entity
+// =============================================================================
+Entity World::allocateEntity() {
+    Entity entity;
+    if (!freeIndices.empty()) {
+        entity.index = freeIndices.back();
+        freeIndices.pop_back();
+    }
+    else {
+        entity.index = std::uint32_t(records.size());
+        records.push_back({-1, 0, 0, 0});
+    }
+    entity.generation = records[entity.index].generation;
+    numAlive++;
+    return entity;
+}
+
+// =============================================================================
+// Remove Row
+// =============================================================================
+// Removes the record's row and fixes the record of the entity moved into it.
+void World::removeRow(const Record& record) {
+    Entity moved = archetypes[record.archetype]->removeRow(record.chunk, record.row);
+    if (!moved.isNull()) {
+        records[moved.index].chunk = record.chunk;
+        records[moved.index].row = record.row;
+    }
+}
+
+// =============================================================================
+// Move Row
+// =============================================================================
+// Moves an entity to another archetype, copying the components both share.
+void World::moveRow(Entity entity, int toArchetype) {
+    const std::vector<ComponentInfo>& infos = getComponentInfos();
+    Record from = records[entity.index];
+    Archetype& source = *archetypes[from.archetype];
+    Archetype& target = *archetypes[toArchetype];
+
+    Record to = {toArchetype, 0, 0, from.generation};
+    target.addRow(entity, to.chunk, to.row);
+
+    ComponentMask shared = source.getMask() & target.getMask();
+    for (int id = 0; id < ECS_MAX_COMPONENTS; id++) {
+        if (shared & (ComponentMask(1) << id)) {
+            size_t size = infos[id].size;
+            std::memcpy(target.getColumn(to.chunk, id) + to.row * size, source.getColumn(from.chunk, id) + from.row * size, size);
+        }
+    }
+
+    removeRow(from);
+    records[entity.index] = to;
+}
+
+// =============================================================================
+// Write Component
+// =============================================================================
+template <typename T>
+void World::writeComponent(const Record& record, const T& component) {
+    ((T*)archetypes[record.archetype]->getColumn(record.chunk, getComponentId<T>()))[record.row] = component;
+}
+
+#endif // ECS_H
@@ -0,0 +1,577 @@
+#ifndef FLOW_FIELD_H
+#define FLOW_FIELD_H
+
+// local includes
+#include "types.h"
+#include "chunk.h"
+#include "pathfinder.h"
+#include "thread_pool.h"
+
+// STL includes
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// definitions
+#define FLOW_FIELD_RADIUS 8 // chunks covered around the goal's chunk
+#define FLOW_CACHE_FIELDS 32 // fields kept before the least recently used goes
+#define FLOW_DIR_NONE 8 // goal, blocked, unreachable or outside the field
+#define FLOW_BUCKETS 16 // more than the largest step cost
+
+// =============================================================================
+// FlowField Class
+// =============================================================================
+// Direction toward one goal tile for every tile of the
+// (2 * FLOW_FIELD_RADIUS + 1) squared chunks around the goal's chunk.  Each
+// tile stores one of the 8 moves of Pathfinder, the first step of a
+// cheapest path to the goal, so any number of units heading for the same
+// goal share one field.  Built by FlowFieldCache and immutable after that.
+class FlowField {
+    public:
+        vec2i_t getGoal() const { return goal; };
+        std::uint8_t getDirectionIndex(int tileX, int tileY) const;
+        bool getDirection(int tileX, int tileY, vec2f_t& dir) const;
+        bool isInside(int tileX, int tileY) const;
+
+    private:
+        friend class FlowFieldCache;
+
+        vec2i_t goal;
+        vec2i_t chunkMin; // first chunk of the window
+        int size = 0; // chunks per side of the window
+        std::vector<std::uint8_t> dirs; // CHUNK_TILES per chunk, chunks row major
+        std::vector<std::uint64_t> revisions; // Pathfinder revision per chunk, 0 if absent
+};
+
+// =============================================================================
+// FlowFieldCache Class
+// =============================================================================
+// Builds flow fields from the pathfinder's walkability and keeps the
+// FLOW_CACHE_FIELDS most recently requested ones.  A cached field is reused
+// until a chunk in its window arrives, leaves or is edited.
+//
+// The integration field, the cost from every tile to the goal, is computed
+// per chunk.  A sweep runs Dijkstra over one chunk seeded with its own
+// costs so far and a one tile border read from its neighbors; a chunk whose
+// border costs dropped wakes the neighbors facing them for the next round.
+// All sweeps of a round read the previous round's costs, so they run in
+// parallel on the workers, and rounds repeat until no chunk changes.
+// Directions are then derived per chunk, again in parallel, by stepping to
+// the cheapest neighbor.
+//
+// Moves and costs match Pathfinder: 8-way without cutting corners, chunks
+// that are not resident are blocked.  Call from one thread; it waits for
+// its own jobs before returning.
+class FlowFieldCache {
+    public:
+        FlowFieldCache(const Pathfinder& pathfinder, ThreadPool& workers);
+        FlowFieldCache(const FlowFieldCache&) = delete;
+        FlowFieldCache& operator=(const FlowFieldCache&) = delete;
+        std::shared_ptr<const FlowField> get(vec2i_t goal);
+        void clear() { fields.clear(); };
+        size_t size() const { return fields.size(); };
+        size_t getNumComputed() const { return numComputed; };
+
+    private:
+        static const int PADDED_X = CHUNK_TILES_X + 2;
+        static const int PADDED_Y = CHUNK_TILES_Y + 2;
+        static const int PADDED_TILES = PADDED_X * PADDED_Y;
+
+        struct Sector {
+            const std::uint32_t* walkable; // nullptr if not resident
+            bool isActive; // queued for the coming round
+            bool isChanged; // costs dropped in the last sweep
+            std::uint8_t wakeMask; // bit d: the neighbor at FLOW_DX[d], FLOW_DY[d] saw a drop
+        };
+
+        void compute(FlowField& field);
+        void pad(int sector, std::uint32_t* cost, bool* open) const;
+        void sweep(int sector);
+        void derive(FlowField& field, int sector) const;
+        bool isStale(const FlowField& field) const;
+        void runParallel(const std::vector<int>& batch, const std::function<void(int)>& func);
+
+        const Pathfinder& pathfinder;
+        ThreadPool& workers;
+        std::list<std::shared_ptr<FlowField>> fields; // most recently used first
+        size_t numComputed = 0;
+
+        // scratch of compute(), one window
+        vec2i_t chunkMin;
+        int windowSize = 0; // chunks per side
+        int goalSector = 0;
+        int goalPadded = 0; // goal tile in the padded layout of pad()
+        std::vector<Sector> sectors;
+        std::vector<std::uint32_t> costs; // CHUNK_TILES per sector
+        std::vector<std::uint32_t> costsNext;
+};
+
+// moves in the order of Pathfinder::search(), diagonals last
+static const int FLOW_DX[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+static const int FLOW_DY[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+// =============================================================================
+// Is Inside
+// =============================================================================
+bool FlowField::isInside(int tileX, int tileY) const {
+    int x = getChunkCoordOfTileX(tileX) - chunkMin.x;
+    int y = getChunkCoordOfTileY(tileY) - chunkMin.y;
+    return x >= 0 && y >= 0 && x < size && y < size;
+}
+
+// =============================================================================
+// Get Direction Index
+// =============================================================================
+// Index into FLOW_DX / FLOW_DY, or FLOW_DIR_NONE.
+std::uint8_t FlowField::getDirectionIndex(int tileX, int tileY) const {
+    int chunkX = getChunkCoordOfTileX(tileX);
+    int chunkY = getChunkCoordOfTileY(tileY);
+    int x = chunkX - chunkMin.x;
+    int y = chunkY - chunkMin.y;
+    if (x < 0 || y < 0 || x >= size || y >= size) {
+        return FLOW_DIR_NONE;
+    }
+
+    int localX = tileX - chunkX * CHUNK_TILES_X;
+    int localY = tileY - chunkY * CHUNK_TILES_Y;
+    return dirs[size_t(y * size + x) * CHUNK_TILES + localY * CHUNK_TILES_X + localX];
+}
+
+// =============================================================================
+// Get Direction
+// =============================================================================
+// Unit vector of the move at a tile; false where there is none.
+bool FlowField::getDirection(int tileX, int tileY, vec2f_t& dir) const {
+    std::uint8_t d = getDirectionIndex(tileX, tileY);
+    if (d == FLOW_DIR_NONE) {
+        return false;
+    }
+
+    float scale = d >= 4 ? 0.70710678f : 1.0f;
+    dir.x = FLOW_DX[d] * scale;
+    dir.y = FLOW_DY[d] * scale;
+    return true;
+}
+
+// =============================================================================
+// Construct FlowFieldCache
+// =============================================================================
+// Only keeps the references; nothing is computed until get().
+FlowFieldCache::FlowFieldCache(const Pathfinder& pathfinder, ThreadPool& workers)
+        : pathfinder(pathfinder),
+          workers(workers) {
+
+    chunkMin.x = 0;
+    chunkMin.y = 0;
+}
+
+// =============================================================================
+// Get
+// =============================================================================
+// Field toward a world tile, or nullptr if that tile is blocked or not
+// resident.  Callers may hold on to the field after it leaves the cache.
+std::shared_ptr<const FlowField> FlowFieldCache::get(vec2i_t goal) {
+
+    if (!pathfinder.isWalkable(goal.x, goal.y)) {
+        return nullptr;
+    }
+
+    for (auto it = fields.begin(); it != fields.end(); ++it) {
+        if ((*it)->goal.x != goal.x || (*it)->goal.y != goal.y) {
+            continue;
+        }
+        if (isStale(**it)) {
+            fields.erase(it);
+            break;
+        }
+        fields.splice(fields.begin(), fields, it);
+        return fields.front();
+    }
+
+    std::shared_ptr<FlowField> field = std::make_shared<FlowField>();
+    field->goal = goal;
+    compute(*field);
+    numComputed++;
+
+    fields.push_front(field);
+    if (fields.size() > FLOW_CACHE_FIELDS) {
+        fields.pop_back();
+    }
+    return field;
+}
+
+// =============================================================================
+// Is Stale
+// =============================================================================
+bool FlowFieldCache::isStale(const FlowField& field) const {
+    for (int y = 0; y < field.size; y++) {
+        for (int x = 0; x < field.size; x++) {
+            std::uint64_t revision = pathfinder.getChunkRevision(field.chunkMin.x + x, field.chunkMin.y + y);
+            if (revision != field.revisions[y * field.size + x]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// =============================================================================
+// Compute
+// =============================================================================
+void FlowFieldCache::compute(FlowField& field) {
+
+    windowSize = 2 * FLOW_FIELD_RADIUS + 1;
+    chunkMin.x = getChunkCoordOfTileX(field.goal.x) - FLOW_FIELD_RADIUS;
+    chunkMin.y = getChunkCoordOfTileY(field.goal.y) - FLOW_FIELD_RADIUS;
+    int numSectors = windowSize * windowSize;
+
+    field.chunkMin = chunkMin;
+    field.size = windowSize;
+    field.revisions.resize(numSectors);
+    sectors.resize(numSectors);
+    for (int i = 0; i < numSectors; i++) {
+        int x = chunkMin.x + i % windowSize;
+        int y = chunkMin.y + i / windowSize;
+        sectors[i].walkable = pathfinder.getWalkableRows(x, y);
+        sectors[i].isActive = false;
+        sectors[i].isChanged = false;
+        sectors[i].wakeMask = 0;
+        field.revisions[i] = pathfinder.getChunkRevision(x, y);
+    }
+
+    costs.assign(size_t(numSectors) * CHUNK_TILES, PATH_COST_INFINITE);
+    costsNext.resize(costs.size());
+
+    // the goal's chunk is the center of the window; its first sweep seeds it
+    goalSector = FLOW_FIELD_RADIUS * windowSize + FLOW_FIELD_RADIUS;
+    int goalLocalX = field.goal.x - (chunkMin.x + FLOW_FIELD_RADIUS) * CHUNK_TILES_X;
+    int goalLocalY = field.goal.y - (chunkMin.y + FLOW_FIELD_RADIUS) * CHUNK_TILES_Y;
+    goalPadded = (goalLocalY + 1) * PADDED_X + goalLocalX + 1;
+
+    std::vector<int> batch(1, goalSector);
+    while (!batch.empty()) {
+        runParallel(batch, [this](int i) { sweep(i); });
+
+        // publish the new costs, then wake the neighbors bordering a change
+        for (int i : batch) {
+            sectors[i].isActive = false;
+            if (sectors[i].isChanged) {
+                std::memcpy(&costs[size_t(i) * CHUNK_TILES], &costsNext[size_t(i) * CHUNK_TILES],
+                    CHUNK_TILES * sizeof(std::uint32_t));
+            }
+        }
+
+        std::vector<int> next;
+        for (int i : batch) {
+            int x = i % windowSize;
+            int y = i / windowSize;
+            for (int d = 0; d < 8; d++) {
+                if (!(sectors[i].wakeMask & (1u << d))) {
+                    continue;
+                }
+                int nx = x + FLOW_DX[d];
+                int ny = y + FLOW_DY[d];
+                if (nx < 0 || ny < 0 || nx >= windowSize || ny >= windowSize) {
+                    continue;
+                }
+                int n = ny * windowSize + nx;
+                if (sectors[n].walkable != nullptr && !sectors[n].isActive) {
+                    sectors[n].isActive = true;
+                    next.push_back(n);
+                }
+            }
+        }
+        batch.swap(next);
+    }
+
+    field.dirs.assign(size_t(numSectors) * CHUNK_TILES, FLOW_DIR_NONE);
+    for (int i = 0; i < numSectors; i++) {
+        if (sectors[i].walkable != nullptr) {
+            batch.push_back(i);
+        }
+    }
+    runParallel(batch, [this, &field](int i) { derive(field, i); });
+}
+
+// =============================================================================
+// Pad
+// =============================================================================
+// Gathers a sector's costs and walkability plus a one tile border from its
+// neighbors, PADDED_X tiles per row.  Tiles outside the window or in
+// absent chunks are closed.
+void FlowFieldCache::pad(int sector, std::uint32_t* cost, bool* open) const {
+
+    int sectorX = sector % windowSize;
+    int sectorY = sector / windowSize;
+
+    // padded columns [beg, end) come from the neighbor at dx from localX on
+    static const int COLUMN_BEG[3] = {0, 1, PADDED_X - 1};
+    static const int COLUMN_END[3] = {1, PADDED_X - 1, PADDED_X};
+    static const int COLUMN_LOCAL[3] = {CHUNK_TILES_X - 1, 0, 0};
+
+    for (int py = 0; py < PADDED_Y; py++) {
+        int dy = py == 0 ? -1 : (py == PADDED_Y - 1 ? 1 : 0);
+        int localY = py - 1 - dy * CHUNK_TILES_Y;
+        int ny = sectorY + dy;
+
+        for (int dx = -1; dx <= 1; dx++) {
+            int nx = sectorX + dx;
+            const std::uint32_t* walkable = nullptr;
+            if (nx >= 0 && ny >= 0 && nx < windowSize && ny < windowSize) {
+                walkable = sectors[ny * windowSize + nx].walkable;
+            }
+
+            int beg = COLUMN_BEG[dx + 1];
+            int end = COLUMN_END[dx + 1];
+            int localX = COLUMN_LOCAL[dx + 1];
+            std::uint32_t* costOut = cost + py * PADDED_X;
+            bool* openOut = open + py * PADDED_X;
+            if (walkable == nullptr) {
+                std::fill(costOut + beg, costOut + end, PATH_COST_INFINITE);
+                std::fill(openOut + beg, openOut + end, false);
+                continue;
+            }
+
+            std::uint32_t row = walkable[localY];
+            const std::uint32_t* costIn = &costs[size_t(ny * windowSize + nx) * CHUNK_TILES + localY * CHUNK_TILES_X];
+            for (int px = beg; px < end; px++, localX++) {
+                openOut[px] = ((row >> localX) & 1u) != 0;
+                costOut[px] = costIn[localX];
+            }
+        }
+    }
+}
+
+// =============================================================================
+// Sweep
+// =============================================================================
+// Dijkstra over one sector from its border and the goal.  The sector's own
+// costs from earlier sweeps are upper bounds, so only tiles that drop below
+// them are expanded and a repeated sweep costs what changed.  Writes the
+// result to costsNext, sets isChanged if any cost dropped and wakeMask for
+// the neighbors facing a border tile that dropped.  Only reads costs, so
+// sweeps of one round can run together.
+//
+// Steps cost PATH_COST_STRAIGHT or PATH_COST_DIAGONAL, so the open set is
+// a ring of buckets one per cost modulo FLOW_BUCKETS; the seeds are sorted
+// and join it as the front reaches their cost.
+void FlowFieldCache::sweep(int sector) {
+
+    std::uint32_t cost[PADDED_TILES];
+    bool open[PADDED_TILES];
+    pad(sector, cost, open);
+    if (sector == goalSector) {
+        cost[goalPadded] = 0;
+    }
+
+    typedef std::pair<std::uint32_t, std::uint16_t> Entry; // cost, padded tile
+    std::vector<Entry> seeds;
+    auto addSeed = [&](int p) {
+        if (open[p] && cost[p] != PATH_COST_INFINITE) {
+            seeds.push_back({cost[p], std::uint16_t(p)});
+        }
+    };
+    for (int px = 0; px < PADDED_X; px++) {
+        addSeed(px);
+        addSeed((PADDED_Y - 1) * PADDED_X + px);
+    }
+    for (int py = 1; py < PADDED_Y - 1; py++) {
+        addSeed(py * PADDED_X);
+        addSeed(py * PADDED_X + PADDED_X - 1);
+    }
+    if (sector == goalSector) {
+        addSeed(goalPadded);
+    }
+    std::sort(seeds.begin(), seeds.end());
+
+    std::vector<std::uint16_t> buckets[FLOW_BUCKETS];
+    size_t numQueued = 0;
+    size_t nextSeed = 0;
+    std::uint32_t front = seeds.empty() ? 0 : seeds[0].first;
+
+    while (numQueued > 0 || nextSeed < seeds.size()) {
+
+        // nothing within reach of the front, skip ahead to the next seed
+        if (numQueued == 0) {
+            front = std::max(front, seeds[nextSeed].first);
+        }
+        while (nextSeed < seeds.size() && seeds[nextSeed].first == front) {
+            buckets[front % FLOW_BUCKETS].push_back(seeds[nextSeed].second);
+            numQueued++;
+            nextSeed++;
+        }
+
+        std::vector<std::uint16_t>& bucket = buckets[front % FLOW_BUCKETS];
+        while (!bucket.empty()) {
+            int p = bucket.back();
+            bucket.pop_back();
+            numQueued--;
+            if (cost[p] != front) {
+                continue; // reached cheaper since
+            }
+
+            int x = p % PADDED_X;
+            int y = p / PADDED_X;
+            for (int d = 0; d < 8; d++) {
+                int nx = x + FLOW_DX[d];
+                int ny = y + FLOW_DY[d];
+
+                // only the sector itself is relaxed, the border is fixed
+                if (nx < 1 || ny < 1 || nx > CHUNK_TILES_X || ny > CHUNK_TILES_Y) {
+                    continue;
+                }
+                int next = ny * PADDED_X + nx;
+                if (!open[next]) {
+                    continue;
+                }
+
+                // diagonals only between two open tiles
+                bool isDiagonal = d >= 4;
+                if (isDiagonal && (!open[y * PADDED_X + nx] || !open[ny * PADDED_X + x])) {
+                    continue;
+                }
+
+                std::uint32_t nextCost = front + (isDiagonal ? PATH_COST_DIAGONAL : PATH_COST_STRAIGHT);
+                if (nextCost >= cost[next]) {
+                    continue;
+                }
+                cost[next] = nextCost;
+                buckets[nextCost % FLOW_BUCKETS].push_back(std::uint16_t(next));
+                numQueued++;
+            }
+        }
+        front++;
+    }
+
+    const std::uint32_t* prev = &costs[size_t(sector) * CHUNK_TILES];
+    std::uint32_t* out = &costsNext[size_t(sector) * CHUNK_TILES];
+    bool isChanged = false;
+    std::uint8_t wakeMask = 0;
+    for (int y = 0; y < CHUNK_TILES_Y; y++) {
+        for (int x = 0; x < CHUNK_TILES_X; x++) {
+            std::uint32_t c = cost[(y + 1) * PADDED_X + x + 1];
+            out[y * CHUNK_TILES_X + x] = c;
+            if (c >= prev[y * CHUNK_TILES_X + x]) {
+                continue;
+            }
+            isChanged = true;
+
+            // the neighbors whose border this tile is
+            int dx = x == 0 ? -1 : (x == CHUNK_TILES_X - 1 ? 1 : 0);
+            int dy = y == 0 ? -1 : (y == CHUNK_TILES_Y - 1 ? 1 : 0);
+            if (dx == 0 && dy == 0) {
+                continue;
+            }
+            for (int d = 0; d < 8; d++) {
+                bool isFacing = (FLOW_DX[d] == 0 || FLOW_DX[d] == dx) && (FLOW_DY[d] == 0 || FLOW_DY[d] == dy);
+                if (isFacing) {
+                    wakeMask |= std::uint8_t(1u << d);
+                }
+            }
+        }
+    }
+    sectors[sector].isChanged = isChanged;
+    sectors[sector].wakeMask = wakeMask;
+}
+
+// =============================================================================
+// Derive
+// =============================================================================
+// Points every reachable tile of a sector at its cheapest neighbor.
+void FlowFieldCache::derive(FlowField& field, int sector) const {
+
+    std::uint32_t cost[PADDED_TILES];
+    bool open[PADDED_TILES];
+    pad(sector, cost, open);
+
+    std::uint8_t* out = &field.dirs[size_t(sector) * CHUNK_TILES];
+    for (int y = 1; y <= CHUNK_TILES_Y; y++) {
+        for (int x = 1; x <= CHUNK_TILES_X; x++) {
+            int p = y * PADDED_X + x;
+            if (!open[p] || cost[p] == 0 || cost[p] == PATH_COST_INFINITE) {
+                continue;
+            }
+
+            // the neighbor the cost came from; step costs break the ties
+            std::uint32_t best = PATH_COST_INFINITE;
+            std::uint8_t bestDir = FLOW_DIR_NONE;
+            for (int d = 0; d < 8; d++) {
+                int nx = x + FLOW_DX[d];
+                int ny = y + FLOW_DY[d];
+                int next = ny * PADDED_X + nx;
+                bool isDiagonal = d >= 4;
+                if (!open[next] || (isDiagonal && (!open[y * PADDED_X + nx] || !open[ny * PADDED_X + x]))) {
+                    continue;
+                }
+                if (cost[next] == PATH_COST_INFINITE) {
+                    continue;
+                }
+                std::uint32_t through = cost[next] + (isDiagonal ? PATH_COST_DIAGONAL : PATH_COST_STRAIGHT);
+                if (through < best) {
+                    best = through;
+                    bestDir = std::uint8_t(d);
+                }
+            }
+            out[(y - 1) * CHUNK_TILES_X + x - 1] = bestDir;
+        }
+    }
+}
+
+// =============================================================================
+// Run Parallel
+// =============================================================================
+// Calls func for every sector of a batch and waits for all of them.  The
+// calling thread claims sectors alongside the workers, so the batch
+// finishes even if every worker is busy with chunk generation; helpers that
+// start after the last sector was claimed only touch the shared counters.
+void FlowFieldCache::runParallel(const std::vector<int>& batch, const std::function<void(int)>& func) {
+
+    struct Shared {
+        std::atomic<size_t> next;
+        size_t count;
+        size_t numDone = 0;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+    std::shared_ptr<Shared> shared = std::make_shared<Shared>();
+    shared->next = 0;
+    shared->count = batch.size();
+
+    // the batch and func outlive every claimed sector, not every helper
+    const std::vector<int>* sectorsOf = &batch;
+    const std::function<void(int)>* funcOf = &func;
+    auto work = [shared, sectorsOf, funcOf] {
+        size_t numClaimed = 0;
+        for (size_t i = shared->next++; i < shared->count; i = shared->next++) {
+            (*funcOf)((*sectorsOf)[i]);
+            numClaimed++;
+        }
+        if (numClaimed > 0) {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->numDone += numClaimed;
+            shared->condition.notify_one();
+        }
+    };
+
+    if (batch.empty()) {
+        return;
+    }
+    size_t numHelpers = std::min(batch.size() - 1, size_t(workers.getNumThreads()));
+    for (size_t i = 0; i < numHelpers; i++) {
+        workers.submit(work);
+    }
+    work();
+
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->condition.wait(lock, [&shared, &batch] { return shared->numDone == batch.size(); });
+}
+
+#endif // FLOW_FIELD_H
@@ -0,0 +1,128 @@
+#ifndef LOCK_FREE_QUEUE_H
+#define LOCK_FREE_QUEUE_H
+
+// STL includes
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// definitions
+#define CACHE_LINE_SIZE 64
+
+// =============================================================================
+// LockFreeQueue Class
+// =============================================================================
+// Bounded multi-producer multi-consumer queue (Dmitry Vyukov's sequence
+// numbered ring buffer).  push and pop never block; they return false when
+// the queue is full or empty.
+template <typename T>
+class LockFreeQueue {
+    public:
+        LockFreeQueue(size_t capacity);
+        LockFreeQueue(const LockFreeQueue&) = delete;
+        LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+        bool push(T&& value);
+        bool pop(T& value);
+        size_t getCapacity() { return mask + 1; };
+
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            T data;
+        };
+
+        std::unique_ptr<Cell[]> cells;
+        size_t mask;
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueuePos;
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeuePos;
+};
+
+// =============================================================================
+// Construct LockFreeQueue
+// =============================================================================
+template <typename T>
+LockFreeQueue<T>::LockFreeQueue(size_t capacity) {
+
+    // round capacity up to a power of two so positions wrap with a mask
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    cells.reset(new Cell[size]);
+    mask = size - 1;
+
+    for (size_t i = 0; i < size; i++) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    enqueuePos.store(0, std::memory_order_relaxed);
+    dequeuePos.store(0, std::memory_order_relaxed);
+}
+
+// =============================================================================
+// Push
+// =============================================================================
+template <typename T>
+bool LockFreeQueue<T>::push(T&& value) {
+
+    Cell* cell;
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+
+    for (;;) {
+        cell = &cells[pos & mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = std::ptrdiff_t(seq) - std::ptrdiff_t(pos);
+
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return false; // full
+        }
+        else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->data = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+// =============================================================================
+// Pop
+// =============================================================================
+template <typename T>
+bool LockFreeQueue<T>::pop(T& value) {
+
+    Cell* cell;
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+
+    for (;;) {
+        cell = &cells[pos & mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = std::ptrdiff_t(seq) - std::ptrdiff_t(pos + 1);
+
+        if (diff == 0) {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return false; // empty
+        }
+        else {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    value = std::move(cell->data);
+    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    return true;
+}
+
+#endif // LOCK_FREE_QUEUE_H
\ No newline at end of file
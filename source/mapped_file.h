@@ -0,0 +1,121 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+// third party includes
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// STL includes
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// =============================================================================
+// MappedFile Class
+// =============================================================================
+// Read-only memory mapping of a whole file.
+class MappedFile {
+    public:
+        MappedFile() {};
+        ~MappedFile() { close(); };
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        bool open(const std::string& filepath);
+        void close();
+        const std::uint8_t* getData() const { return data; };
+        size_t getSize() const { return size; };
+
+    private:
+        const std::uint8_t* data = nullptr;
+        size_t size = 0;
+#ifdef _WIN32
+        HANDLE fileHandle = INVALID_HANDLE_VALUE;
+        HANDLE mapHandle = nullptr;
+#endif
+};
+
+// =============================================================================
+// Open Mapped File
+// =============================================================================
+bool MappedFile::open(const std::string& filepath) {
+
+    close();
+
+#ifdef _WIN32
+    fileHandle = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(fileHandle, &fileSize);
+    size = size_t(fileSize.QuadPart);
+
+    mapHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapHandle == nullptr) {
+        close();
+        return false;
+    }
+
+    data = (const std::uint8_t*)MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    size = size_t(st.st_size);
+
+    // the mapping stays valid after the descriptor is closed
+    void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    data = (p == MAP_FAILED) ? nullptr : (const std::uint8_t*)p;
+#endif
+
+    if (data == nullptr) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+// =============================================================================
+// Close Mapped File
+// =============================================================================
+void MappedFile::close() {
+#ifdef _WIN32
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+    }
+    if (mapHandle != nullptr) {
+        CloseHandle(mapHandle);
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+    }
+    mapHandle = nullptr;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (data != nullptr) {
+        munmap((void*)data, size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,561 @@
+#ifndef PATH_SERVICE_H
+#define PATH_SERVICE_H
+
+// local includes
+#include "types.h"
+#include "chunk.h"
+#include "chunk_grid.h"
+#include "pathfinder.h"
+
+// STL includes
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// definitions
+#define PATH_SERVICE_THREADS 2
+#define PATH_SERVICE_BUDGET_MS 4.0 // worker time per tick, summed over the workers
+#define PATH_SERVICE_SLICE_MS 0.5 // worker time taken from the budget at once
+#define PATH_SERVICE_SLICE_STEPS 4 // search steps between clock checks
+
+// request status
+#define PATH_STATUS_UNKNOWN 0 // never issued or released
+#define PATH_STATUS_PENDING 1
+#define PATH_STATUS_FOUND 2
+#define PATH_STATUS_FAILED 3
+
+typedef std::uint32_t PathHandle; // 0 is never issued
+
+// =============================================================================
+// PathService Class
+// =============================================================================
+// Answers path requests on worker threads so game logic never waits for a
+// search.  request() returns a handle at once; the path shows up behind it
+// at a later tick boundary.
+//
+// Requests from the same start chunk to the same goal tile are merged into
+// one search from the first one's start.  Once it ends, every other start
+// of the group is joined onto the path by a search within the start chunk,
+// and its handle gets the joined path.  A start that cannot reach the path
+// within the chunk is searched again on its own.  Merging lasts until the
+// search ends.
+//
+// Each worker owns a Pathfinder replica, so searches never touch the chunk
+// manager or its pathfinder.  sync() copies the walkability of chunks that
+// arrived, left or were edited since the last call, and workers apply the
+// changes between searches, so each search sees one consistent snapshot.
+// Clusters dirtied by a change are rebuilt a step at a time while no
+// search is waiting, or by the first search that needs them; both count
+// against the budget.
+//
+// beginTick() marks a tick boundary: results finished since the last one
+// become visible and the workers get a fresh budget of budgetMs, counted in
+// search time over all workers.  Once it is spent they idle until the next
+// tick, so a large order is spread over as many ticks as it needs instead
+// of stalling one.  Workers take the budget in slices of
+// PATH_SERVICE_SLICE_MS and count a running slice as spent, so a tick
+// overshoots its budget by at most one slice.  A search still running at
+// the end of a slice is suspended and continued by the same worker, whose
+// replica holds its state; the worker applies changes once it has ended.
+//
+// sync() belongs on the thread owning the chunks; request(), beginTick()
+// and the getters may be called from any one other thread.
+class PathService {
+    public:
+        PathService(int numThreads = PATH_SERVICE_THREADS, double budgetMs = PATH_SERVICE_BUDGET_MS);
+        ~PathService();
+        PathService(const PathService&) = delete;
+        PathService& operator=(const PathService&) = delete;
+        void sync(const Pathfinder& source);
+        PathHandle request(vec2i_t start, vec2i_t goal);
+        int getStatus(PathHandle handle);
+        std::shared_ptr<const std::vector<vec2i_t>> getPath(PathHandle handle);
+        void release(PathHandle handle);
+        void beginTick();
+        void setBudget(double ms);
+        size_t getNumQueued();
+        size_t getNumRequested();
+        size_t getNumSearched();
+        double getSpentMs(); // search time of the last finished tick
+
+    private:
+        typedef std::tuple<int, int, int, int> JobKey; // start chunk, goal tile
+
+        struct Request {
+            int status;
+            vec2i_t start;
+            std::shared_ptr<const std::vector<vec2i_t>> path;
+        };
+
+        struct Job {
+            JobKey key;
+            vec2i_t start;
+            vec2i_t goal;
+            std::vector<PathHandle> handles; // guarded by mutex until the search ends
+            std::vector<Request> results; // per handle, from the end of the search
+            std::shared_ptr<std::vector<vec2i_t>> path; // from start
+            bool isSearched = false;
+            bool isFound = false;
+            size_t numJoined = 0;
+        };
+
+        struct Update {
+            vec2i_t pos;
+            bool isRemoved;
+            std::uint32_t walkable[CHUNK_TILES_Y];
+        };
+
+        struct Worker {
+            Pathfinder pathfinder; // worker thread only
+            std::vector<Update> updates; // not applied yet
+            int resetWidth = 0; // grid size to reset to first, if not 0
+            int resetHeight = 0;
+            bool hasDirty = false; // replica may have clusters to rebuild, worker thread only
+            std::shared_ptr<Job> job; // searched or joined across slices, worker thread only
+            std::thread thread;
+        };
+
+        struct Known {
+            std::uint64_t revision;
+            std::uint32_t stamp; // last sync() that saw the chunk
+        };
+
+        void work(Worker& worker);
+        void join(Worker& worker, const Job& job, Request& result);
+
+        // sync() only
+        ChunkGrid<Known> known;
+        std::uint64_t syncedRevision = 0;
+        std::uint32_t numSyncs = 0;
+        std::vector<Update> changes;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool isRunning = true;
+        double budgetMs;
+        double spentMs = 0.0; // this tick
+        double reservedMs = 0.0; // slices running
+        double spentMsPrev = 0.0;
+        PathHandle nextHandle = 1;
+        std::unordered_map<PathHandle, Request> requests;
+        std::map<JobKey, std::shared_ptr<Job>> jobs; // until delivered
+        std::deque<std::shared_ptr<Job>> queue;
+        std::vector<std::shared_ptr<Job>> finished; // delivered by beginTick()
+        size_t numRequested = 0;
+        size_t numSearched = 0;
+
+        // declared last so the workers are joined before anything they use
+        // is destroyed
+        std::vector<std::unique_ptr<Worker>> workers;
+};
+
+// =============================================================================
+// Construct PathService
+// =============================================================================
+PathService::PathService(int numThreads, double budgetMs)
+        : budgetMs(budgetMs) {
+
+    for (int i = 0; i < std::max(1, numThreads); i++) {
+        workers.emplace_back(new Worker());
+    }
+    for (std::unique_ptr<Worker>& worker : workers) {
+        worker->thread = std::thread(&PathService::work, this, std::ref(*worker));
+    }
+}
+
+// =============================================================================
+// Destruct PathService
+// =============================================================================
+// Searches still queued or suspended are dropped; running slices are
+// finished first.
+PathService::~PathService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isRunning = false;
+    }
+    condition.notify_all();
+
+    for (std::unique_ptr<Worker>& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+// =============================================================================
+// Sync
+// =============================================================================
+// Brings the replicas up to date with the resident chunks of source.  Cheap
+// when nothing changed since the last call.
+void PathService::sync(const Pathfinder& source) {
+
+    bool isResized = known.getWidth() != source.getGridWidth() || known.getHeight() != source.getGridHeight();
+    if (!isResized && source.getRevision() == syncedRevision) {
+        return;
+    }
+    if (isResized) {
+        known.reset(source.getGridWidth(), source.getGridHeight());
+    }
+    syncedRevision = source.getRevision();
+    numSyncs++;
+
+    changes.clear();
+    source.forEachChunk([this](vec2i_t pos, const std::uint32_t* walkable, std::uint64_t revision) {
+        Known* entry = known.find(pos.x, pos.y);
+        if (entry == nullptr) {
+            entry = &known.insert(pos.x, pos.y, {0, 0});
+        }
+        entry->stamp = numSyncs;
+        if (entry->revision == revision) {
+            return;
+        }
+        entry->revision = revision;
+
+        Update update;
+        update.pos = pos;
+        update.isRemoved = false;
+        std::copy(walkable, walkable + CHUNK_TILES_Y, update.walkable);
+        changes.push_back(update);
+    });
+    known.eraseIf([this](vec2i_t pos, const Known& entry) {
+        if (entry.stamp == numSyncs) {
+            return false;
+        }
+        Update update;
+        update.pos = pos;
+        update.isRemoved = true;
+        changes.push_back(update);
+        return true;
+    });
+
+    if (!isResized && changes.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::unique_ptr<Worker>& worker : workers) {
+            if (isResized) {
+                worker->updates.clear();
+                worker->resetWidth = source.getGridWidth();
+                worker->resetHeight = source.getGridHeight();
+            }
+            worker->updates.insert(worker->updates.end(), changes.begin(), changes.end());
+        }
+    }
+    condition.notify_all();
+}
+
+// =============================================================================
+// Request
+// =============================================================================
+// Queues a search between two world tiles, or joins one already queued from
+// the same start chunk to the same goal.
+PathHandle PathService::request(vec2i_t start, vec2i_t goal) {
+
+    JobKey key(getChunkCoordOfTileX(start.x), getChunkCoordOfTileY(start.y), goal.x, goal.y);
+
+    bool isQueued = false;
+    PathHandle handle;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        handle = nextHandle++;
+        if (nextHandle == 0) {
+            nextHandle = 1;
+        }
+        requests[handle] = {PATH_STATUS_PENDING, start, nullptr};
+        numRequested++;
+
+        std::shared_ptr<Job>& job = jobs[key];
+        if (!job) {
+            job = std::make_shared<Job>();
+            job->key = key;
+            job->start = start;
+            job->goal = goal;
+            job->path = std::make_shared<std::vector<vec2i_t>>();
+            queue.push_back(job);
+            isQueued = true;
+        }
+        job->handles.push_back(handle);
+    }
+
+    if (isQueued) {
+        condition.notify_one();
+    }
+    return handle;
+}
+
+// =============================================================================
+// Get Status
+// =============================================================================
+int PathService::getStatus(PathHandle handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = requests.find(handle);
+    return it != requests.end() ? it->second.status : PATH_STATUS_UNKNOWN;
+}
+
+// =============================================================================
+// Get Path
+// =============================================================================
+// Tiles from the request's start to the goal, both included, once the
+// status is PATH_STATUS_FOUND; nullptr before that or if there is none.
+std::shared_ptr<const std::vector<vec2i_t>> PathService::getPath(PathHandle handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = requests.find(handle);
+    return it != requests.end() ? it->second.path : nullptr;
+}
+
+// =============================================================================
+// Release
+// =============================================================================
+// Forgets a handle.  Its search still runs if other handles share it.
+void PathService::release(PathHandle handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    requests.erase(handle);
+}
+
+// =============================================================================
+// Begin Tick
+// =============================================================================
+// Delivers the results finished since the last tick and renews the budget.
+void PathService::beginTick() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const std::shared_ptr<Job>& job : finished) {
+            for (size_t i = 0; i < job->handles.size(); i++) {
+                const Request& result = job->results[i];
+                auto it = requests.find(job->handles[i]);
+                if (result.status != PATH_STATUS_PENDING && it != requests.end()) {
+                    it->second.status = result.status;
+                    it->second.path = result.path;
+                }
+            }
+        }
+        finished.clear();
+        spentMsPrev = spentMs;
+        spentMs = 0.0;
+    }
+    condition.notify_all();
+}
+
+// =============================================================================
+// Set Budget
+// =============================================================================
+// Milliseconds of search per tick over all workers, from the next tick on.
+void PathService::setBudget(double ms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budgetMs = ms;
+}
+
+// =============================================================================
+// Getters
+// =============================================================================
+size_t PathService::getNumQueued() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size();
+}
+
+size_t PathService::getNumRequested() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return numRequested;
+}
+
+size_t PathService::getNumSearched() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return numSearched;
+}
+
+double PathService::getSpentMs() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return spentMsPrev;
+}
+
+// =============================================================================
+// Work
+// =============================================================================
+// Worker thread: applies the walkability changes synced since it last
+// looked, then, while the tick's budget lasts, runs a slice of its search,
+// of a new one, or else of rebuilding dirty clusters.  Changes are applied
+// even without budget so they do not pile up, but never while a search is
+// suspended.
+void PathService::work(Worker& worker) {
+
+    std::vector<Update> updates;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condition.wait(lock, [this, &worker] {
+            return !isRunning ||
+                   (!worker.job && (!worker.updates.empty() || worker.resetWidth != 0)) ||
+                   (spentMs + reservedMs < budgetMs && (worker.job || !queue.empty() || worker.hasDirty));
+        });
+        if (!isRunning) {
+            return;
+        }
+
+        bool isStarting = false;
+        bool isSlice = false;
+        if (spentMs + reservedMs < budgetMs) {
+            if (!worker.job && !queue.empty()) {
+                worker.job = queue.front();
+                queue.pop_front();
+                isStarting = true;
+            }
+            isSlice = worker.job || worker.hasDirty;
+        }
+        if (isSlice) {
+            reservedMs += PATH_SERVICE_SLICE_MS;
+        }
+
+        updates.clear();
+        int resetWidth = 0;
+        int resetHeight = 0;
+        if (!worker.job || isStarting) {
+            updates.swap(worker.updates);
+            resetWidth = worker.resetWidth;
+            resetHeight = worker.resetHeight;
+            worker.resetWidth = 0;
+            worker.resetHeight = 0;
+        }
+        lock.unlock();
+
+        if (resetWidth != 0) {
+            worker.pathfinder.reset(resetWidth, resetHeight);
+        }
+        for (const Update& update : updates) {
+            if (update.isRemoved) {
+                worker.pathfinder.removeChunk(update.pos.x, update.pos.y);
+            }
+            else {
+                worker.pathfinder.setChunk(update.pos.x, update.pos.y, update.walkable);
+            }
+        }
+        worker.hasDirty = worker.hasDirty || resetWidth != 0 || !updates.empty();
+
+        auto beg = std::chrono::steady_clock::now();
+        auto deadline = beg + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(PATH_SERVICE_SLICE_MS));
+
+        Job* job = isSlice ? worker.job.get() : nullptr;
+        bool isSearchEnded = false;
+        bool isJoinEnded = false;
+        if (job && !job->isSearched) {
+            if (isStarting) {
+                worker.pathfinder.startPath(job->start, job->goal, *job->path);
+            }
+            int status = PATH_SEARCH_RUNNING;
+            do {
+                status = worker.pathfinder.continuePath(PATH_SERVICE_SLICE_STEPS);
+            } while (status == PATH_SEARCH_RUNNING && std::chrono::steady_clock::now() < deadline);
+            isSearchEnded = status != PATH_SEARCH_RUNNING;
+            job->isFound = status == PATH_SEARCH_FOUND;
+        }
+        else if (job) {
+            while (job->numJoined < job->results.size() && std::chrono::steady_clock::now() < deadline) {
+                join(worker, *job, job->results[job->numJoined++]);
+            }
+            isJoinEnded = job->numJoined == job->results.size();
+        }
+        else if (isSlice) {
+            do {
+                worker.hasDirty = worker.pathfinder.rebuildNext();
+            } while (worker.hasDirty && std::chrono::steady_clock::now() < deadline);
+        }
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beg).count();
+
+        lock.lock();
+        if (isSlice) {
+            reservedMs -= PATH_SERVICE_SLICE_MS;
+            spentMs += ms;
+        }
+
+        // later requests start a search of their own; the handles merged so
+        // far are joined from here on
+        if (isSearchEnded) {
+            job->isSearched = true;
+            jobs.erase(job->key);
+            for (PathHandle handle : job->handles) {
+                auto it = requests.find(handle);
+                if (it != requests.end()) {
+                    job->results.push_back({PATH_STATUS_PENDING, it->second.start, nullptr});
+                }
+                else {
+                    job->results.push_back({PATH_STATUS_UNKNOWN, job->start, nullptr});
+                }
+            }
+            numSearched++;
+        }
+
+        // starts that could not join search again, merged as usual
+        if (isJoinEnded) {
+            bool isQueued = false;
+            for (size_t i = 0; i < job->handles.size(); i++) {
+                const Request& result = job->results[i];
+                if (result.status != PATH_STATUS_PENDING) {
+                    continue;
+                }
+                std::shared_ptr<Job>& retry = jobs[job->key];
+                if (!retry) {
+                    retry = std::make_shared<Job>();
+                    retry->key = job->key;
+                    retry->start = result.start;
+                    retry->goal = job->goal;
+                    retry->path = std::make_shared<std::vector<vec2i_t>>();
+                    queue.push_back(retry);
+                    isQueued = true;
+                }
+                retry->handles.push_back(job->handles[i]);
+            }
+            finished.push_back(worker.job);
+            worker.job.reset();
+            if (isQueued) {
+                condition.notify_all();
+            }
+        }
+    }
+}
+
+// =============================================================================
+// Join
+// =============================================================================
+// Resolves one handle of an ended search.  Its start either is the
+// search's start, joins the path within the start chunk, or, if there is
+// no path, shares the search's failure when connected to its start there.
+// Otherwise the result stays pending and is searched again.
+void PathService::join(Worker& worker, const Job& job, Request& result) {
+
+    if (result.status != PATH_STATUS_PENDING) {
+        return;
+    }
+
+    if (result.start.x == job.start.x && result.start.y == job.start.y) {
+        result.status = job.isFound ? PATH_STATUS_FOUND : PATH_STATUS_FAILED;
+        if (job.isFound) {
+            result.path = job.path;
+        }
+        return;
+    }
+
+    std::shared_ptr<std::vector<vec2i_t>> joined = std::make_shared<std::vector<vec2i_t>>();
+    if (job.isFound) {
+        if (worker.pathfinder.joinPath(result.start, *job.path, *joined)) {
+            result.status = PATH_STATUS_FOUND;
+            result.path = joined;
+        }
+        return;
+    }
+
+    std::vector<vec2i_t> origin(1, job.start);
+    if (worker.pathfinder.joinPath(result.start, origin, *joined)) {
+        result.status = PATH_STATUS_FAILED;
+    }
+}
+
+#endif // PATH_SERVICE_H
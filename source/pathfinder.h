@@ -0,0 +1,853 @@
+#ifndef PATHFINDER_H
+#define PATHFINDER_H
+
+// local includes
+#include "types.h"
+#include "chunk.h"
+#include "chunk_grid.h"
+
+// STL includes
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// definitions
+#define PATH_COST_STRAIGHT 10
+#define PATH_COST_DIAGONAL 14
+#define PATH_COST_NONE 0xFFFFu // unreachable, fits a chunk's longest path
+#define PATH_COST_INFINITE 0xFFFFFFFFu
+#define PATH_ENTRANCE_SPLIT 6 // entrances this wide get a node at each end
+
+// search status
+#define PATH_SEARCH_RUNNING 0
+#define PATH_SEARCH_FOUND 1
+#define PATH_SEARCH_FAILED 2
+
+// cluster sides, side ^ 1 being the opposite one
+#define PATH_SIDE_WEST 0 // x = 0
+#define PATH_SIDE_EAST 1 // x = CHUNK_TILES_X - 1
+#define PATH_SIDE_NORTH 2 // y = 0
+#define PATH_SIDE_SOUTH 3 // y = CHUNK_TILES_Y - 1
+
+static_assert(CHUNK_TILES_X <= 32, "walkable rows are 32 bit masks");
+
+// =============================================================================
+// Walkability
+// =============================================================================
+inline bool isTileWalkable(std::uint8_t tile) {
+    return tile != TILE_WATER;
+}
+
+// =============================================================================
+// Pathfinder Class
+// =============================================================================
+// Hierarchical A* (HPA*) over resident chunks, one cluster per chunk.
+//
+// Each cluster keeps its own copy of the chunk's walkability as bit rows,
+// the entrance nodes on its four borders and the cost between every pair of
+// its nodes within the chunk.  An entrance is a run of tiles walkable on
+// both sides of a border; it gets one node in its middle, or one at each
+// end once it is PATH_ENTRANCE_SPLIT tiles wide, mirrored on both sides.
+// Clusters are rebuilt lazily on the first query after their chunk or a
+// neighbor changed; a neighbor is only affected if the edge facing it did.
+//
+// findPath() searches the abstract graph of entrance nodes, with the start
+// and goal attached by a search of their own clusters, then refines every
+// step inside a cluster with a local A* bounded to that chunk.  Moves are
+// 8-way without cutting corners.  Chunks that are not resident count as
+// blocked.
+//
+// The same search can also be run in pieces: startPath() sets it up and
+// each continuePath() runs a bounded number of steps, keeping the open set
+// and the refinement position in between.  No chunk may change while such a
+// search is unfinished.  joinPath() attaches another start in the same
+// chunk to a found path.
+//
+// Coordinates are world tiles (see getTileCoordX()).  Not thread safe.
+class Pathfinder {
+    public:
+        Pathfinder() {};
+        void reset(int width, int height);
+        void setChunk(const Chunk& chunk);
+        void setChunk(int chunkX, int chunkY, const std::uint32_t* walkable);
+        void removeChunk(int chunkX, int chunkY);
+        bool isWalkable(int tileX, int tileY) const;
+        bool findPath(vec2i_t start, vec2i_t goal, std::vector<vec2i_t>& path);
+        void startPath(vec2i_t start, vec2i_t goal, std::vector<vec2i_t>& path);
+        int continuePath(int maxSteps);
+        bool joinPath(vec2i_t start, const std::vector<vec2i_t>& path, std::vector<vec2i_t>& joined);
+        bool rebuildNext();
+        size_t getNumClusters() const { return clusters.size(); };
+        size_t getNumRebuilt() const { return numRebuilt; };
+        const std::uint32_t* getWalkableRows(int chunkX, int chunkY) const;
+        std::uint64_t getChunkRevision(int chunkX, int chunkY) const;
+        std::uint64_t getRevision() const { return revision; };
+        template <typename Func> void forEachChunk(Func func) const;
+        int getGridWidth() const { return clusters.getWidth(); };
+        int getGridHeight() const { return clusters.getHeight(); };
+
+    private:
+        struct Node {
+            std::uint8_t x;
+            std::uint8_t y;
+            std::uint8_t side;
+            std::uint8_t offset; // along the side
+        };
+
+        struct Cluster;
+
+        struct NodeRef {
+            Cluster* cluster; // nullptr for the start or goal
+            int node;
+        };
+
+        // abstract search state, valid if query is the current one
+        struct Visit {
+            std::uint32_t cost;
+            NodeRef parent;
+            std::uint32_t query;
+        };
+
+        struct Entry {
+            std::uint32_t estimate;
+            NodeRef ref;
+            bool operator>(const Entry& other) const { return estimate > other.estimate; };
+        };
+
+        // the search run by continuePath()
+        struct Search {
+            vec2i_t start;
+            vec2i_t goal;
+            std::vector<vec2i_t>* path = nullptr;
+            int status = PATH_SEARCH_FAILED;
+            bool isStarted = false;
+            bool isRefining = false;
+            Cluster* startCluster = nullptr;
+            Cluster* goalCluster = nullptr;
+            int startTile = 0;
+            int goalTile = 0;
+            std::uint32_t query = 0;
+            std::uint32_t goalCost = PATH_COST_INFINITE;
+            NodeRef goalParent = {nullptr, -1};
+            std::vector<NodeRef> refs; // abstract nodes from the first one after the start
+            size_t numRefined = 0;
+            Cluster* cluster = nullptr; // refined up to this tile
+            int tile = 0;
+            std::uint16_t goalDist[CHUNK_TILES]; // to the goal within its cluster
+        };
+
+        struct Cluster {
+            vec2i_t pos;
+            std::uint32_t walkable[CHUNK_TILES_Y] = {};
+            bool isDirty = true;
+            int numBuilt = -1; // cost rows of the rebuild in progress, -1 before its nodes
+            std::uint64_t revision = 0; // of the last change to walkable
+            std::vector<Node> nodes;
+            std::vector<std::uint16_t> costs; // nodes.size() squared, row major
+            std::vector<Visit> visits; // one per node
+        };
+
+        Cluster* findNeighbor(const Cluster& cluster, int side);
+        void markDirty(int chunkX, int chunkY);
+        bool rebuildStep(Cluster& cluster);
+        void addEntrances(Cluster& cluster, int side);
+        void beginSearch();
+        void expandNext();
+        void refineNext();
+        void relax(Cluster* cluster, int node, std::uint32_t cost, NodeRef parent);
+
+        static bool isWalkable(const Cluster& cluster, int x, int y) { return (cluster.walkable[y] >> x) & 1u; };
+        static int getHeuristic(int dx, int dy);
+        static void search(const Cluster& cluster, int from, int to, std::uint16_t* dist, std::uint16_t* parents);
+        void appendLocalPath(const Cluster& cluster, int from, int to, std::vector<vec2i_t>& path);
+
+        ChunkGrid<Cluster> clusters;
+        size_t numRebuilt = 0; // clusters rebuilt since construction
+        std::uint64_t revision = 0; // bumped by every walkability change
+        std::uint32_t numQueries = 0;
+        std::vector<Entry> open; // abstract search heap
+        Search current;
+
+        // scratch of one local search
+        std::uint16_t dist[CHUNK_TILES];
+        std::uint16_t parents[CHUNK_TILES];
+};
+
+// =============================================================================
+// Reset
+// =============================================================================
+// Sized like the chunk manager's resident grid, so the same window fits.
+void Pathfinder::reset(int width, int height) {
+    clusters.reset(width, height);
+}
+
+// =============================================================================
+// Set Chunk
+// =============================================================================
+// Adds a resident chunk or takes over its edited tiles.
+void Pathfinder::setChunk(const Chunk& chunk) {
+
+    TileArray2D tiles;
+    chunk.getData(tiles);
+
+    std::uint32_t walkable[CHUNK_TILES_Y];
+    for (int y = 0; y < CHUNK_TILES_Y; y++) {
+        std::uint32_t row = 0;
+        for (int x = 0; x < CHUNK_TILES_X; x++) {
+            row |= std::uint32_t(isTileWalkable(tiles[y][x])) << x;
+        }
+        walkable[y] = row;
+    }
+
+    vec2i_t pos = chunk.getPosition();
+    setChunk(pos.x, pos.y, walkable);
+}
+
+// =============================================================================
+// Set Chunk
+// =============================================================================
+// Same from walkability bit rows, bit x of row y, as getWalkableRows().
+void Pathfinder::setChunk(int chunkX, int chunkY, const std::uint32_t* walkable) {
+
+    vec2i_t pos;
+    pos.x = chunkX;
+    pos.y = chunkY;
+    Cluster* cluster = clusters.find(pos.x, pos.y);
+    bool isNew = cluster == nullptr;
+
+    // edits that keep walkability, like grass to sand, leave the graph and
+    // the flow fields built from this revision valid
+    if (!isNew && std::equal(walkable, walkable + CHUNK_TILES_Y, cluster->walkable)) {
+        return;
+    }
+
+    if (isNew) {
+        Cluster added;
+        added.pos = pos;
+        cluster = &clusters.insert(pos.x, pos.y, std::move(added));
+    }
+
+    // neighbors only see this chunk's edges
+    std::uint32_t edgeMask = (1u << (CHUNK_TILES_X - 1)) | 1u;
+    bool isWestChanged = isNew;
+    bool isEastChanged = isNew;
+    bool isNorthChanged = isNew || cluster->walkable[0] != walkable[0];
+    bool isSouthChanged = isNew || cluster->walkable[CHUNK_TILES_Y - 1] != walkable[CHUNK_TILES_Y - 1];
+    for (int y = 0; y < CHUNK_TILES_Y && !isNew; y++) {
+        std::uint32_t changed = (cluster->walkable[y] ^ walkable[y]) & edgeMask;
+        isWestChanged = isWestChanged || (changed & 1u);
+        isEastChanged = isEastChanged || (changed >> (CHUNK_TILES_X - 1));
+    }
+
+    std::copy(walkable, walkable + CHUNK_TILES_Y, cluster->walkable);
+    cluster->isDirty = true;
+    cluster->numBuilt = -1;
+    cluster->revision = ++revision;
+
+    if (isWestChanged) markDirty(pos.x - 1, pos.y);
+    if (isEastChanged) markDirty(pos.x + 1, pos.y);
+    if (isNorthChanged) markDirty(pos.x, pos.y - 1);
+    if (isSouthChanged) markDirty(pos.x, pos.y + 1);
+}
+
+// =============================================================================
+// Remove Chunk
+// =============================================================================
+void Pathfinder::removeChunk(int chunkX, int chunkY) {
+    if (!clusters.erase(chunkX, chunkY)) {
+        return;
+    }
+    revision++;
+    markDirty(chunkX - 1, chunkY);
+    markDirty(chunkX + 1, chunkY);
+    markDirty(chunkX, chunkY - 1);
+    markDirty(chunkX, chunkY + 1);
+}
+
+// =============================================================================
+// Is Walkable
+// =============================================================================
+bool Pathfinder::isWalkable(int tileX, int tileY) const {
+    int chunkX = getChunkCoordOfTileX(tileX);
+    int chunkY = getChunkCoordOfTileY(tileY);
+    const Cluster* cluster = clusters.find(chunkX, chunkY);
+    return cluster != nullptr &&
+           isWalkable(*cluster, tileX - chunkX * CHUNK_TILES_X, tileY - chunkY * CHUNK_TILES_Y);
+}
+
+// =============================================================================
+// Get Walkable Rows
+// =============================================================================
+// One bit per tile, bit x of row y, or nullptr if the chunk is not resident.
+const std::uint32_t* Pathfinder::getWalkableRows(int chunkX, int chunkY) const {
+    const Cluster* cluster = clusters.find(chunkX, chunkY);
+    return cluster != nullptr ? cluster->walkable : nullptr;
+}
+
+// =============================================================================
+// Get Chunk Revision
+// =============================================================================
+// Revision of the last walkability change of a resident chunk, or 0.
+std::uint64_t Pathfinder::getChunkRevision(int chunkX, int chunkY) const {
+    const Cluster* cluster = clusters.find(chunkX, chunkY);
+    return cluster != nullptr ? cluster->revision : 0;
+}
+
+// =============================================================================
+// For Each Chunk
+// =============================================================================
+// Calls func(vec2i_t pos, const std::uint32_t* walkable, std::uint64_t
+// revision) for every resident chunk.
+template <typename Func>
+void Pathfinder::forEachChunk(Func func) const {
+    clusters.forEach([&func](vec2i_t pos, const Cluster& cluster) {
+        func(pos, cluster.walkable, cluster.revision);
+    });
+}
+
+// =============================================================================
+// Find Path
+// =============================================================================
+// Fills path with every tile from start to goal, both included.  Returns
+// false, leaving path empty, if there is no path through resident chunks.
+bool Pathfinder::findPath(vec2i_t start, vec2i_t goal, std::vector<vec2i_t>& path) {
+    startPath(start, goal, path);
+    return continuePath(std::numeric_limits<int>::max()) == PATH_SEARCH_FOUND;
+}
+
+// =============================================================================
+// Start Path
+// =============================================================================
+// Sets up the search findPath() runs, without running any of it.  path is
+// filled by continuePath() and must outlive the search.
+void Pathfinder::startPath(vec2i_t start, vec2i_t goal, std::vector<vec2i_t>& path) {
+    path.clear();
+    current.start = start;
+    current.goal = goal;
+    current.path = &path;
+    current.status = PATH_SEARCH_RUNNING;
+    current.isStarted = false;
+    current.isRefining = false;
+}
+
+// =============================================================================
+// Continue Path
+// =============================================================================
+// Runs up to maxSteps steps of the search set up by startPath() and returns
+// its status, PATH_SEARCH_RUNNING while it is unfinished.  A step attaches
+// the start and goal to the graph, expands one abstract node or refines one
+// of them into tiles; one that needs a dirty cluster instead takes a step
+// of rebuilding it, so no step costs more than a search within one chunk.
+int Pathfinder::continuePath(int maxSteps) {
+
+    int numSteps = 0;
+    while (current.status == PATH_SEARCH_RUNNING && !current.isStarted && numSteps < maxSteps) {
+        numSteps++;
+        beginSearch();
+    }
+    while (current.status == PATH_SEARCH_RUNNING && !current.isRefining && numSteps < maxSteps) {
+        numSteps++;
+        expandNext();
+    }
+    while (current.status == PATH_SEARCH_RUNNING && current.isRefining && numSteps < maxSteps) {
+        numSteps++;
+        refineNext();
+    }
+    return current.status;
+}
+
+// =============================================================================
+// Join Path
+// =============================================================================
+// Fills joined with a path from start, walking within start's chunk onto
+// path and following it to its end.  Of the tiles of path in that chunk, it
+// joins at the one that gives the cheapest total.  Returns false, leaving
+// joined empty, if none of them is reachable without leaving the chunk.
+bool Pathfinder::joinPath(vec2i_t start, const std::vector<vec2i_t>& path, std::vector<vec2i_t>& joined) {
+
+    joined.clear();
+    int chunkX = getChunkCoordOfTileX(start.x);
+    int chunkY = getChunkCoordOfTileY(start.y);
+    const Cluster* cluster = clusters.find(chunkX, chunkY);
+    int baseX = chunkX * CHUNK_TILES_X;
+    int baseY = chunkY * CHUNK_TILES_Y;
+    if (cluster == nullptr || !isWalkable(*cluster, start.x - baseX, start.y - baseY)) {
+        return false;
+    }
+
+    int startTile = (start.y - baseY) * CHUNK_TILES_X + start.x - baseX;
+    search(*cluster, startTile, -1, dist, parents);
+
+    // walk the path backwards, summing the cost of following it to its end
+    std::uint32_t bestCost = PATH_COST_INFINITE;
+    size_t bestIndex = 0;
+    std::uint32_t remaining = 0;
+    for (size_t i = path.size(); i-- > 0;) {
+        if (i + 1 < path.size()) {
+            bool isDiagonal = path[i].x != path[i + 1].x && path[i].y != path[i + 1].y;
+            remaining += isDiagonal ? PATH_COST_DIAGONAL : PATH_COST_STRAIGHT;
+        }
+        int x = path[i].x - baseX;
+        int y = path[i].y - baseY;
+        if (x < 0 || y < 0 || x >= CHUNK_TILES_X || y >= CHUNK_TILES_Y) {
+            continue;
+        }
+        std::uint16_t cost = dist[y * CHUNK_TILES_X + x];
+        if (cost != PATH_COST_NONE && cost + remaining < bestCost) {
+            bestCost = cost + remaining;
+            bestIndex = i;
+        }
+    }
+    if (bestCost == PATH_COST_INFINITE) {
+        return false;
+    }
+
+    int joinTile = (path[bestIndex].y - baseY) * CHUNK_TILES_X + path[bestIndex].x - baseX;
+    for (int tile = joinTile; tile != startTile; tile = parents[tile]) {
+        vec2i_t step;
+        step.x = baseX + tile % CHUNK_TILES_X;
+        step.y = baseY + tile / CHUNK_TILES_X;
+        joined.push_back(step);
+    }
+    joined.push_back(start);
+    std::reverse(joined.begin(), joined.end());
+    joined.insert(joined.end(), path.begin() + bestIndex + 1, path.end());
+    return true;
+}
+
+// =============================================================================
+// Rebuild Next
+// =============================================================================
+// Takes one rebuild step of a dirty cluster ahead of the queries that would
+// need it, so the cost can be spread out; false once none is left.
+bool Pathfinder::rebuildNext() {
+    Cluster* dirty = nullptr;
+    clusters.forEach([&dirty](vec2i_t, Cluster& cluster) {
+        if (dirty == nullptr && cluster.isDirty) {
+            dirty = &cluster;
+        }
+    });
+
+    if (dirty == nullptr) {
+        return false;
+    }
+    rebuildStep(*dirty);
+    return true;
+}
+
+// =============================================================================
+// Find Neighbor
+// =============================================================================
+// The neighboring cluster across a side, dirty or not.
+Pathfinder::Cluster* Pathfinder::findNeighbor(const Cluster& cluster, int side) {
+    switch (side) {
+        case PATH_SIDE_WEST: return clusters.find(cluster.pos.x - 1, cluster.pos.y);
+        case PATH_SIDE_EAST: return clusters.find(cluster.pos.x + 1, cluster.pos.y);
+        case PATH_SIDE_NORTH: return clusters.find(cluster.pos.x, cluster.pos.y - 1);
+        default: return clusters.find(cluster.pos.x, cluster.pos.y + 1);
+    }
+}
+
+// =============================================================================
+// Mark Dirty
+// =============================================================================
+void Pathfinder::markDirty(int chunkX, int chunkY) {
+    Cluster* cluster = clusters.find(chunkX, chunkY);
+    if (cluster != nullptr) {
+        cluster->isDirty = true;
+        cluster->numBuilt = -1;
+    }
+}
+
+// =============================================================================
+// Rebuild Step
+// =============================================================================
+// One step of rebuilding a dirty cluster: first the entrance nodes on every
+// side facing a resident neighbor, then per step the costs from one of them
+// to the others.  Returns true once the cluster is clean.
+bool Pathfinder::rebuildStep(Cluster& cluster) {
+
+    if (!cluster.isDirty) {
+        return true;
+    }
+
+    size_t numNodes = cluster.nodes.size();
+    if (cluster.numBuilt < 0) {
+        cluster.nodes.clear();
+        for (int side = 0; side < 4; side++) {
+            addEntrances(cluster, side);
+        }
+        numNodes = cluster.nodes.size();
+        cluster.visits.assign(numNodes, {0, {nullptr, -1}, 0});
+        cluster.costs.assign(numNodes * numNodes, std::uint16_t(PATH_COST_NONE));
+        cluster.numBuilt = 0;
+    }
+    else {
+        size_t a = size_t(cluster.numBuilt++);
+        const Node& from = cluster.nodes[a];
+        search(cluster, from.y * CHUNK_TILES_X + from.x, -1, dist, nullptr);
+        for (size_t b = 0; b < numNodes; b++) {
+            const Node& to = cluster.nodes[b];
+            cluster.costs[a * numNodes + b] = dist[to.y * CHUNK_TILES_X + to.x];
+        }
+    }
+
+    if (size_t(cluster.numBuilt) < numNodes) {
+        return false;
+    }
+    cluster.isDirty = false;
+    numRebuilt++;
+    return true;
+}
+
+// =============================================================================
+// Add Entrances
+// =============================================================================
+// Both clusters of a border find the same runs, so their nodes mirror each
+// other at equal offsets.
+void Pathfinder::addEntrances(Cluster& cluster, int side) {
+
+    const Cluster* neighbor = findNeighbor(cluster, side);
+    if (neighbor == nullptr) {
+        return;
+    }
+
+    // walkable on both sides, one bit per offset along the side
+    const int lastX = CHUNK_TILES_X - 1;
+    const int lastY = CHUNK_TILES_Y - 1;
+    bool isVertical = side == PATH_SIDE_WEST || side == PATH_SIDE_EAST;
+    int length = isVertical ? CHUNK_TILES_Y : CHUNK_TILES_X;
+    std::uint32_t open = 0;
+    for (int i = 0; i < length; i++) {
+        bool isOpen = false;
+        switch (side) {
+            case PATH_SIDE_WEST: isOpen = isWalkable(cluster, 0, i) && isWalkable(*neighbor, lastX, i); break;
+            case PATH_SIDE_EAST: isOpen = isWalkable(cluster, lastX, i) && isWalkable(*neighbor, 0, i); break;
+            case PATH_SIDE_NORTH: isOpen = isWalkable(cluster, i, 0) && isWalkable(*neighbor, i, lastY); break;
+            default: isOpen = isWalkable(cluster, i, lastY) && isWalkable(*neighbor, i, 0); break;
+        }
+        open |= std::uint32_t(isOpen) << i;
+    }
+
+    auto addNode = [&](int offset) {
+        Node node;
+        node.x = std::uint8_t(isVertical ? (side == PATH_SIDE_WEST ? 0 : lastX) : offset);
+        node.y = std::uint8_t(isVertical ? offset : (side == PATH_SIDE_NORTH ? 0 : lastY));
+        node.side = std::uint8_t(side);
+        node.offset = std::uint8_t(offset);
+        cluster.nodes.push_back(node);
+    };
+
+    for (int i = 0; i < length;) {
+        if (!((open >> i) & 1u)) {
+            i++;
+            continue;
+        }
+        int beg = i;
+        while (i < length && ((open >> i) & 1u)) {
+            i++;
+        }
+        int end = i - 1;
+
+        if (end - beg + 1 >= PATH_ENTRANCE_SPLIT) {
+            addNode(beg);
+            addNode(end);
+        }
+        else {
+            addNode((beg + end) / 2);
+        }
+    }
+}
+
+// =============================================================================
+// Begin Search
+// =============================================================================
+// Attaches the start and goal to the abstract graph by a search of their
+// own clusters, or finishes a path within one cluster right away.  Dirty
+// start and goal clusters take a rebuild step per call first.
+void Pathfinder::beginSearch() {
+
+    vec2i_t start = current.start;
+    vec2i_t goal = current.goal;
+    std::vector<vec2i_t>& path = *current.path;
+    if (!isWalkable(start.x, start.y) || !isWalkable(goal.x, goal.y)) {
+        current.status = PATH_SEARCH_FAILED;
+        return;
+    }
+
+    Cluster* startCluster = clusters.find(getChunkCoordOfTileX(start.x), getChunkCoordOfTileY(start.y));
+    Cluster* goalCluster = clusters.find(getChunkCoordOfTileX(goal.x), getChunkCoordOfTileY(goal.y));
+    if (!rebuildStep(*startCluster) || !rebuildStep(*goalCluster)) {
+        return;
+    }
+    current.isStarted = true;
+    int startTile = (start.y - startCluster->pos.y * CHUNK_TILES_Y) * CHUNK_TILES_X + start.x - startCluster->pos.x * CHUNK_TILES_X;
+    int goalTile = (goal.y - goalCluster->pos.y * CHUNK_TILES_Y) * CHUNK_TILES_X + goal.x - goalCluster->pos.x * CHUNK_TILES_X;
+    current.startCluster = startCluster;
+    current.goalCluster = goalCluster;
+    current.startTile = startTile;
+    current.goalTile = goalTile;
+
+    // paths within one chunk rarely need the abstract graph
+    path.push_back(start);
+    if (startCluster == goalCluster) {
+        appendLocalPath(*startCluster, startTile, goalTile, path);
+        if (path.back().x == goal.x && path.back().y == goal.y) {
+            current.status = PATH_SEARCH_FOUND;
+            return;
+        }
+        path.resize(1);
+    }
+
+    // costs to the goal and from the start within their clusters
+    search(*goalCluster, goalTile, -1, current.goalDist, nullptr);
+    search(*startCluster, startTile, -1, dist, nullptr);
+
+    // abstract A*, the goal being a node of its own
+    current.query = ++numQueries;
+    current.goalCost = PATH_COST_INFINITE;
+    current.goalParent = {nullptr, -1};
+    open.clear();
+
+    for (int n = 0; n < int(startCluster->nodes.size()); n++) {
+        const Node& node = startCluster->nodes[n];
+        std::uint16_t cost = dist[node.y * CHUNK_TILES_X + node.x];
+        if (cost != PATH_COST_NONE) {
+            relax(startCluster, n, cost, {nullptr, -1});
+        }
+    }
+}
+
+// =============================================================================
+// Expand Next
+// =============================================================================
+// Expands the cheapest open node.  Once the goal is the cheapest, the nodes
+// leading to it are kept for refinement.
+void Pathfinder::expandNext() {
+
+    if (open.empty()) {
+        current.path->clear();
+        current.status = PATH_SEARCH_FAILED;
+        return;
+    }
+
+    // the goal: abstract nodes from the first one after the start to the last one
+    Entry entry = open.front();
+    if (entry.ref.cluster == nullptr) {
+        current.refs.clear();
+        for (NodeRef ref = current.goalParent; ref.cluster != nullptr; ref = ref.cluster->visits[ref.node].parent) {
+            current.refs.push_back(ref);
+        }
+        std::reverse(current.refs.begin(), current.refs.end());
+        current.numRefined = 0;
+        current.cluster = current.startCluster;
+        current.tile = current.startTile;
+        current.isRefining = true;
+        return;
+    }
+
+    // skip entries superseded by a cheaper visit
+    Cluster* cluster = entry.ref.cluster;
+    int index = entry.ref.node;
+    const Node node = cluster->nodes[index];
+    const std::uint32_t cost = cluster->visits[index].cost;
+    int heuristic = getHeuristic(
+        cluster->pos.x * CHUNK_TILES_X + node.x - current.goal.x,
+        cluster->pos.y * CHUNK_TILES_Y + node.y - current.goal.y);
+    bool isSuperseded = entry.estimate > cost + std::uint32_t(heuristic);
+
+    // stays open while the neighbor across its side is rebuilt
+    Cluster* neighbor = findNeighbor(*cluster, node.side);
+    if (!isSuperseded && neighbor != nullptr && !rebuildStep(*neighbor)) {
+        return;
+    }
+    std::pop_heap(open.begin(), open.end(), std::greater<Entry>());
+    open.pop_back();
+    if (isSuperseded) {
+        return;
+    }
+
+    // leave for the goal from its cluster
+    if (cluster == current.goalCluster) {
+        std::uint16_t toGoal = current.goalDist[node.y * CHUNK_TILES_X + node.x];
+        if (toGoal != PATH_COST_NONE && cost + toGoal < current.goalCost) {
+            current.goalCost = cost + toGoal;
+            current.goalParent = entry.ref;
+            open.push_back({current.goalCost, {nullptr, -1}});
+            std::push_heap(open.begin(), open.end(), std::greater<Entry>());
+        }
+    }
+
+    // other nodes of the same cluster
+    size_t numNodes = cluster->nodes.size();
+    const std::uint16_t* costs = cluster->costs.data() + index * numNodes;
+    for (size_t n = 0; n < numNodes; n++) {
+        if (int(n) != index && costs[n] != PATH_COST_NONE) {
+            relax(cluster, int(n), cost + costs[n], entry.ref);
+        }
+    }
+
+    // the mirrored node across the border
+    if (neighbor == nullptr) {
+        return;
+    }
+    int opposite = node.side ^ 1;
+    for (size_t n = 0; n < neighbor->nodes.size(); n++) {
+        if (neighbor->nodes[n].side == opposite && neighbor->nodes[n].offset == node.offset) {
+            relax(neighbor, int(n), cost + PATH_COST_STRAIGHT, entry.ref);
+            break;
+        }
+    }
+}
+
+// =============================================================================
+// Refine Next
+// =============================================================================
+// Turns the next abstract node into tiles, stepping across a border or
+// searching locally within a cluster, and finally walks to the goal.
+void Pathfinder::refineNext() {
+
+    std::vector<vec2i_t>& path = *current.path;
+    if (current.numRefined == current.refs.size()) {
+        appendLocalPath(*current.goalCluster, current.tile, current.goalTile, path);
+        current.status = PATH_SEARCH_FOUND;
+        return;
+    }
+
+    NodeRef ref = current.refs[current.numRefined++];
+    const Node& node = ref.cluster->nodes[ref.node];
+    int nextTile = node.y * CHUNK_TILES_X + node.x;
+    if (ref.cluster == current.cluster) {
+        appendLocalPath(*current.cluster, current.tile, nextTile, path);
+    }
+    else {
+        vec2i_t step;
+        step.x = ref.cluster->pos.x * CHUNK_TILES_X + node.x;
+        step.y = ref.cluster->pos.y * CHUNK_TILES_Y + node.y;
+        path.push_back(step);
+    }
+    current.cluster = ref.cluster;
+    current.tile = nextTile;
+}
+
+// =============================================================================
+// Relax
+// =============================================================================
+// Records a cheaper way to an abstract node and queues it.
+void Pathfinder::relax(Cluster* cluster, int node, std::uint32_t cost, NodeRef parent) {
+
+    Visit& visit = cluster->visits[node];
+    if (visit.query == current.query && visit.cost <= cost) {
+        return;
+    }
+    visit = {cost, parent, current.query};
+
+    const Node& n = cluster->nodes[node];
+    int heuristic = getHeuristic(
+        cluster->pos.x * CHUNK_TILES_X + n.x - current.goal.x,
+        cluster->pos.y * CHUNK_TILES_Y + n.y - current.goal.y);
+    open.push_back({cost + std::uint32_t(heuristic), {cluster, node}});
+    std::push_heap(open.begin(), open.end(), std::greater<Entry>());
+}
+
+// =============================================================================
+// Get Heuristic
+// =============================================================================
+// Octile distance, exact on an open grid.
+int Pathfinder::getHeuristic(int dx, int dy) {
+    dx = std::abs(dx);
+    dy = std::abs(dy);
+    return PATH_COST_STRAIGHT * std::max(dx, dy) + (PATH_COST_DIAGONAL - PATH_COST_STRAIGHT) * std::min(dx, dy);
+}
+
+// =============================================================================
+// Search
+// =============================================================================
+// A* from tile from to tile to within one cluster, or Dijkstra over the
+// whole cluster if to is negative.  Tiles are y * CHUNK_TILES_X + x; dist
+// receives the cost of every settled tile and parents, if given, the tile
+// each was reached from.
+void Pathfinder::search(const Cluster& cluster, int from, int to, std::uint16_t* dist, std::uint16_t* parents) {
+
+    static const int DX[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+    static const int DY[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+    std::fill(dist, dist + CHUNK_TILES, std::uint16_t(PATH_COST_NONE));
+    int toX = to % CHUNK_TILES_X;
+    int toY = to / CHUNK_TILES_X;
+
+    typedef std::pair<std::uint32_t, std::uint16_t> Entry; // estimate, tile
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    dist[from] = 0;
+    open.push({0, std::uint16_t(from)});
+
+    while (!open.empty()) {
+        Entry entry = open.top();
+        open.pop();
+        int tile = entry.second;
+        if (tile == to) {
+            return;
+        }
+
+        int x = tile % CHUNK_TILES_X;
+        int y = tile / CHUNK_TILES_X;
+        std::uint32_t estimate = dist[tile] + (to >= 0 ? getHeuristic(toX - x, toY - y) : 0);
+        if (entry.first > estimate) {
+            continue;
+        }
+
+        for (int d = 0; d < 8; d++) {
+            int nx = x + DX[d];
+            int ny = y + DY[d];
+            if (nx < 0 || ny < 0 || nx >= CHUNK_TILES_X || ny >= CHUNK_TILES_Y || !isWalkable(cluster, nx, ny)) {
+                continue;
+            }
+
+            // diagonals only between two open tiles
+            bool isDiagonal = d >= 4;
+            if (isDiagonal && (!isWalkable(cluster, nx, y) || !isWalkable(cluster, x, ny))) {
+                continue;
+            }
+
+            int next = ny * CHUNK_TILES_X + nx;
+            std::uint32_t cost = dist[tile] + (isDiagonal ? PATH_COST_DIAGONAL : PATH_COST_STRAIGHT);
+            if (cost >= dist[next]) {
+                continue;
+            }
+            dist[next] = std::uint16_t(cost);
+            if (parents != nullptr) {
+                parents[next] = std::uint16_t(tile);
+            }
+            open.push({cost + (to >= 0 ? getHeuristic(toX - nx, toY - ny) : 0), std::uint16_t(next)});
+        }
+    }
+}
+
+// =============================================================================
+// Append Local Path
+// =============================================================================
+// Appends the tiles after from up to and including to, or nothing if to
+// cannot be reached within the cluster.
+void Pathfinder::appendLocalPath(const Cluster& cluster, int from, int to, std::vector<vec2i_t>& path) {
+
+    search(cluster, from, to, dist, parents);
+    if (dist[to] == PATH_COST_NONE) {
+        return;
+    }
+
+    size_t first = path.size();
+    for (int tile = to; tile != from; tile = parents[tile]) {
+        vec2i_t step;
+        step.x = cluster.pos.x * CHUNK_TILES_X + tile % CHUNK_TILES_X;
+        step.y = cluster.pos.y * CHUNK_TILES_Y + tile / CHUNK_TILES_X;
+        path.push_back(step);
+    }
+    std::reverse(path.begin() + first, path.end());
+}
+
+#endif // PATHFINDER_H
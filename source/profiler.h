@@ -0,0 +1,386 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// third party includes
+#ifndef RTS_HEADLESS
+#include <GL/glew.h>
+#endif
+
+// STL includes
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// definitions
+#define PROFILER_GPU_LATENCY 4 // frames before gpu results are read back
+#define PROFILER_MAX_GPU_SCOPES 16 // gpu scopes per frame
+#define PROFILER_MAX_DEPTH 16 // nested cpu scopes
+#define PROFILER_SMOOTHING 0.1f // weight of the newest frame in the averages
+
+// =============================================================================
+// Profiler Class
+// =============================================================================
+// Frame timings for tuning.  CPU scopes nest and are timed with a steady
+// clock.  GPU scopes are GL_TIME_ELAPSED queries in a ring of
+// PROFILER_GPU_LATENCY frames; a frame's queries are only read back when its
+// ring slot comes around again, and only if the results are available, so
+// the profiler never waits on the GPU.  GPU scopes cannot nest.
+//
+// Scope names must outlive the profiler (string literals).  Every frame is
+// bracketed by beginFrame() and endFrame(), which also times the frame as a
+// whole.  startTrace() records the next frames as a Chrome trace JSON file
+// (chrome://tracing or ui.perfetto.dev).
+class Profiler {
+    public:
+        struct Result {
+            const char* name;
+            int depth;
+            float ms; // smoothed over recent frames
+        };
+
+        Profiler();
+        ~Profiler();
+        Profiler(const Profiler&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+        void init();
+        void beginFrame();
+        void endFrame();
+        void beginScope(const char* name);
+        void endScope();
+        void beginGpuScope(const char* name);
+        void endGpuScope();
+        void startTrace(const std::string& filepath, int numFrames);
+        bool isTracing() const { return traceFrames > 0 || !traceFilepath.empty(); };
+        const std::vector<Result>& getCpuResults() const { return cpuResults; };
+        const std::vector<Result>& getGpuResults() const { return gpuResults; };
+        void appendLines(std::vector<std::string>& lines) const;
+
+    private:
+        struct Event {
+            const char* name;
+            int depth;
+            std::int64_t beginUs;
+            std::int64_t durationUs;
+        };
+
+        struct GpuFrame {
+            int numScopes = 0;
+            const char* names[PROFILER_MAX_GPU_SCOPES];
+            std::int64_t beginUs[PROFILER_MAX_GPU_SCOPES]; // cpu submit time for the trace
+#ifndef RTS_HEADLESS
+            GLuint queries[PROFILER_MAX_GPU_SCOPES];
+#endif
+        };
+
+        std::int64_t getTimeUs() const;
+        void resolveGpuFrame(GpuFrame& frame);
+        static void accumulate(std::vector<Result>& results, size_t index, const char* name, int depth, float ms);
+        void writeTrace();
+
+        bool isInitialized = false;
+        std::chrono::steady_clock::time_point origin;
+        std::uint64_t frameIndex = 0;
+
+        // cpu scopes of the current frame
+        int depth = 0;
+        size_t openEvents[PROFILER_MAX_DEPTH]; // index in events of each open scope
+        std::vector<Event> events; // in begin order
+        std::vector<Result> cpuResults;
+
+        // gpu scopes, one ring slot per frame in flight
+        GpuFrame gpuFrames[PROFILER_GPU_LATENCY];
+        bool isGpuScopeOpen = false;
+        std::vector<Result> gpuResults;
+
+        // chrome trace capture, gpu events arrive PROFILER_GPU_LATENCY frames late
+        int traceFrames = 0;
+        int tracePending = 0;
+        std::int64_t traceBeginUs = 0;
+        std::string traceFilepath;
+        std::vector<Event> traceCpuEvents;
+        std::vector<Event> traceGpuEvents;
+};
+
+// =============================================================================
+// ProfileScope Class
+// =============================================================================
+// Times the enclosing block as a cpu scope.
+class ProfileScope {
+    public:
+        ProfileScope(Profiler& profiler, const char* name) : profiler(profiler) { profiler.beginScope(name); };
+        ~ProfileScope() { profiler.endScope(); };
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        Profiler& profiler;
+};
+
+// =============================================================================
+// Construct Profiler
+// =============================================================================
+Profiler::Profiler() {
+    origin = std::chrono::steady_clock::now();
+}
+
+// =============================================================================
+// Destruct Profiler
+// =============================================================================
+Profiler::~Profiler() {
+#ifndef RTS_HEADLESS
+    if (!isInitialized) {
+        return;
+    }
+    for (GpuFrame& frame : gpuFrames) {
+        glDeleteQueries(PROFILER_MAX_GPU_SCOPES, frame.queries);
+    }
+#endif
+}
+
+// =============================================================================
+// Initialize
+// =============================================================================
+// Creates the queries, so it needs a context.  Without init() gpu scopes are
+// ignored.
+void Profiler::init() {
+#ifndef RTS_HEADLESS
+    for (GpuFrame& frame : gpuFrames) {
+        glGenQueries(PROFILER_MAX_GPU_SCOPES, frame.queries);
+    }
+#endif
+    isInitialized = true;
+}
+
+// =============================================================================
+// Begin Frame
+// =============================================================================
+void Profiler::beginFrame() {
+
+    // the ring slot of this frame was last used PROFILER_GPU_LATENCY frames ago
+    GpuFrame& frame = gpuFrames[frameIndex % PROFILER_GPU_LATENCY];
+    resolveGpuFrame(frame);
+    frame.numScopes = 0;
+
+    events.clear();
+    depth = 0;
+    beginScope("frame");
+}
+
+// =============================================================================
+// End Frame
+// =============================================================================
+void Profiler::endFrame() {
+
+    if (isGpuScopeOpen) {
+        endGpuScope();
+    }
+    while (depth > 0) {
+        endScope();
+    }
+
+    for (size_t i = 0; i < events.size(); i++) {
+        accumulate(cpuResults, i, events[i].name, events[i].depth, events[i].durationUs / 1000.0f);
+    }
+    cpuResults.resize(events.size());
+
+    if (traceFrames > 0) {
+        traceCpuEvents.insert(traceCpuEvents.end(), events.begin(), events.end());
+        traceFrames--;
+    }
+    else if (tracePending > 0) {
+        if (--tracePending == 0) {
+            writeTrace();
+        }
+    }
+
+    frameIndex++;
+}
+
+// =============================================================================
+// Begin Scope
+// =============================================================================
+void Profiler::beginScope(const char* name) {
+    if (depth >= PROFILER_MAX_DEPTH) {
+        depth++; // still balanced by endScope(), just not recorded
+        return;
+    }
+    openEvents[depth] = events.size();
+    events.push_back({name, depth, getTimeUs(), 0});
+    depth++;
+}
+
+// =============================================================================
+// End Scope
+// =============================================================================
+void Profiler::endScope() {
+    if (depth <= 0) {
+        std::cout << "WARNING: profiler scope ended without a begin" << std::endl;
+        return;
+    }
+    depth--;
+    if (depth >= PROFILER_MAX_DEPTH) {
+        return;
+    }
+    Event& event = events[openEvents[depth]];
+    event.durationUs = getTimeUs() - event.beginUs;
+}
+
+// =============================================================================
+// Begin GPU Scope
+// =============================================================================
+void Profiler::beginGpuScope(const char* name) {
+    GpuFrame& frame = gpuFrames[frameIndex % PROFILER_GPU_LATENCY];
+    if (!isInitialized || isGpuScopeOpen || frame.numScopes >= PROFILER_MAX_GPU_SCOPES) {
+        return;
+    }
+
+    frame.names[frame.numScopes] = name;
+    frame.beginUs[frame.numScopes] = getTimeUs();
+#ifndef RTS_HEADLESS
+    glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.numScopes]);
+#endif
+    isGpuScopeOpen = true;
+}
+
+// =============================================================================
+// End GPU Scope
+// =============================================================================
+void Profiler::endGpuScope() {
+    if (!isGpuScopeOpen) {
+        return;
+    }
+#ifndef RTS_HEADLESS
+    glEndQuery(GL_TIME_ELAPSED);
+#endif
+    gpuFrames[frameIndex % PROFILER_GPU_LATENCY].numScopes++;
+    isGpuScopeOpen = false;
+}
+
+// =============================================================================
+// Resolve GPU Frame
+// =============================================================================
+// Reads back the queries of a finished frame.  Queries complete in order, so
+// the last one being available means they all are; otherwise the frame is
+// dropped rather than waited for.
+void Profiler::resolveGpuFrame(GpuFrame& frame) {
+    if (frame.numScopes == 0) {
+        return;
+    }
+
+#ifndef RTS_HEADLESS
+    GLint isAvailable = GL_FALSE;
+    glGetQueryObjectiv(frame.queries[frame.numScopes - 1], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+    if (!isAvailable) {
+        return;
+    }
+
+    for (int i = 0; i < frame.numScopes; i++) {
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &ns);
+        accumulate(gpuResults, size_t(i), frame.names[i], 0, ns / 1000000.0f);
+        if ((traceFrames > 0 || tracePending > 0) && frame.beginUs[i] >= traceBeginUs) {
+            traceGpuEvents.push_back({frame.names[i], 0, frame.beginUs[i], std::int64_t(ns / 1000)});
+        }
+    }
+    gpuResults.resize(size_t(frame.numScopes));
+#endif
+}
+
+// =============================================================================
+// Accumulate
+// =============================================================================
+// Scopes are matched by position, which is stable while the frame structure
+// is; a different scope in a position restarts its average.
+void Profiler::accumulate(std::vector<Result>& results, size_t index, const char* name, int depth, float ms) {
+    if (index >= results.size()) {
+        results.push_back({name, depth, ms});
+        return;
+    }
+
+    Result& result = results[index];
+    if (result.name != name || result.depth != depth) {
+        result = {name, depth, ms};
+        return;
+    }
+    result.ms += (ms - result.ms) * PROFILER_SMOOTHING;
+}
+
+// =============================================================================
+// Append Lines
+// =============================================================================
+// Human readable results for the debug screen, cpu scopes indented by depth.
+void Profiler::appendLines(std::vector<std::string>& lines) const {
+    char line[128];
+
+    for (const Result& result : cpuResults) {
+        std::snprintf(line, sizeof(line), "%*scpu %-16s %7.3f ms", result.depth * 2, "", result.name, result.ms);
+        lines.push_back(line);
+    }
+    for (const Result& result : gpuResults) {
+        std::snprintf(line, sizeof(line), "gpu %-16s %7.3f ms", result.name, result.ms);
+        lines.push_back(line);
+    }
+    if (isTracing()) {
+        lines.push_back("tracing...");
+    }
+}
+
+// =============================================================================
+// Start Trace
+// =============================================================================
+void Profiler::startTrace(const std::string& filepath, int numFrames) {
+    if (isTracing() || numFrames <= 0) {
+        return;
+    }
+    traceFilepath = filepath;
+    traceFrames = numFrames;
+    tracePending = PROFILER_GPU_LATENCY;
+    traceBeginUs = getTimeUs();
+    traceCpuEvents.clear();
+    traceGpuEvents.clear();
+}
+
+// =============================================================================
+// Write Trace
+// =============================================================================
+// Complete ("X") events in the Chrome trace event format, cpu scopes on
+// thread 1 and gpu scopes on thread 2 at the time they were submitted.
+void Profiler::writeTrace() {
+
+    std::FILE* file = std::fopen(traceFilepath.c_str(), "w");
+    if (file == nullptr) {
+        std::cout << "WARNING: could not write profiler trace " << traceFilepath << std::endl;
+        traceFilepath.clear();
+        return;
+    }
+
+    std::fprintf(file, "{\"traceEvents\":[\n");
+    std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"cpu\"}},\n");
+    std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"gpu\"}}");
+    for (int tid = 1; tid <= 2; tid++) {
+        for (const Event& event : tid == 1 ? traceCpuEvents : traceGpuEvents) {
+            std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld}",
+                event.name, tid, (long long)event.beginUs, (long long)event.durationUs);
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+    std::fclose(file);
+
+    std::cout << "profiler trace written to " << traceFilepath << std::endl;
+    traceFilepath.clear();
+    traceCpuEvents.clear();
+    traceGpuEvents.clear();
+}
+
+// =============================================================================
+// Get Time
+// =============================================================================
+std::int64_t Profiler::getTimeUs() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - origin).count();
+}
+
+#endif // PROFILER_H
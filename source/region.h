@@ -0,0 +1,407 @@
+#ifndef REGION_H
+#define REGION_H
+
+// local includes
+#include "types.h"
+#include "chunk.h"
+#include "tile_storage.h"
+#include "mapped_file.h"
+
+// STL includes
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// definitions
+#define REGION_CHUNKS_X 32
+#define REGION_CHUNKS_Y 32
+#define REGION_CHUNKS (REGION_CHUNKS_X * REGION_CHUNKS_Y)
+#define REGION_MAGIC 0x52535452 // "RTSR"
+#define REGION_VERSION 2
+#define REGION_SECTOR_SIZE 64 // records are padded to whole sectors
+#define REGION_CACHE_SIZE 16 // open region files
+#define REGION_DIRECTORY "saves/world"
+
+// =============================================================================
+// Region File Layout
+// =============================================================================
+// A region file holds up to 32x32 chunks.  It starts with a header whose
+// offset table has one entry per chunk (offset 0 means not saved), followed
+// by the RLE encoded chunk records.  Records are padded to whole sectors,
+// appended the first time a chunk is saved, and overwritten in place while
+// they still fit their sectors.  All values are little endian.
+struct RegionEntry {
+    std::uint32_t offset;
+    std::uint32_t size;
+};
+
+struct RegionHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    RegionEntry entries[REGION_CHUNKS];
+};
+
+// =============================================================================
+// RegionFile Class
+// =============================================================================
+// One region on disk.  Reads go through a lazily created read-only mapping;
+// writes go through stdio and drop the mapping so the next read sees them.
+// Not thread-safe on its own; RegionStore serializes access.
+class RegionFile {
+    public:
+        RegionFile(const std::string& filepath) : filepath(filepath) {};
+        bool read(int index, TileArray2D& tiles);
+        bool write(int index, const std::vector<std::uint8_t>& record);
+
+    private:
+        bool map();
+
+        std::string filepath;
+        MappedFile mapping;
+        const RegionHeader* header = nullptr;
+        bool isMissing = false;
+};
+
+// =============================================================================
+// Map Region File
+// =============================================================================
+bool RegionFile::map() {
+
+    if (header != nullptr) {
+        return true;
+    }
+    if (isMissing) {
+        return false;
+    }
+
+    if (!mapping.open(filepath)) {
+        isMissing = true;
+        return false;
+    }
+
+    const RegionHeader* h = (const RegionHeader*)mapping.getData();
+    if (mapping.getSize() < sizeof(RegionHeader) ||
+        h->magic != REGION_MAGIC ||
+        h->version != REGION_VERSION) {
+        std::cout << "WARNING: ignoring invalid region file " << filepath << std::endl;
+        mapping.close();
+        isMissing = true;
+        return false;
+    }
+
+    header = h;
+    return true;
+}
+
+// =============================================================================
+// Read Chunk
+// =============================================================================
+bool RegionFile::read(int index, TileArray2D& tiles) {
+
+    if (!map()) {
+        return false;
+    }
+
+    RegionEntry entry = header->entries[index];
+    if (entry.offset == 0 ||
+        size_t(entry.offset) + entry.size > mapping.getSize()) {
+        return false;
+    }
+
+    // decode straight from the page cache mapping
+    return decodeTilesRLE(mapping.getData() + entry.offset, entry.size, tiles);
+}
+
+// =============================================================================
+// Write Chunk
+// =============================================================================
+bool RegionFile::write(int index, const std::vector<std::uint8_t>& record) {
+
+    // the mapping would not see the new file size
+    mapping.close();
+    header = nullptr;
+    isMissing = false;
+
+    std::FILE* file = std::fopen(filepath.c_str(), "r+b");
+    std::unique_ptr<RegionHeader> h(new RegionHeader());
+
+    // create the region file with an empty offset table
+    if (file == nullptr) {
+        file = std::fopen(filepath.c_str(), "w+b");
+        if (file == nullptr) {
+            return false;
+        }
+        std::memset(h.get(), 0, sizeof(RegionHeader));
+        h->magic = REGION_MAGIC;
+        h->version = REGION_VERSION;
+        std::fwrite(h.get(), sizeof(RegionHeader), 1, file);
+    }
+    else if (std::fread(h.get(), sizeof(RegionHeader), 1, file) != 1) {
+        std::fclose(file);
+        return false;
+    }
+
+    // overwrite the record in place if it fits its sectors, else append it
+    RegionEntry& entry = h->entries[index];
+    size_t numSectors = (record.size() + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE;
+    size_t numSectorsOld = (entry.size + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE;
+    bool isMoved = entry.offset == 0 || numSectors > numSectorsOld;
+
+    std::vector<std::uint8_t> padded(record);
+    padded.resize(numSectors * REGION_SECTOR_SIZE, 0);
+
+    if (isMoved) {
+        std::fseek(file, 0, SEEK_END);
+        entry.offset = std::uint32_t(std::ftell(file));
+    }
+    entry.size = std::uint32_t(record.size());
+
+    std::fseek(file, long(entry.offset), SEEK_SET);
+    bool isOk = std::fwrite(padded.data(), padded.size(), 1, file) == 1;
+
+    if (isOk) {
+        std::fseek(file, long((const char*)&entry - (const char*)h.get()), SEEK_SET);
+        isOk = std::fwrite(&entry, sizeof(RegionEntry), 1, file) == 1;
+    }
+
+    std::fclose(file);
+    return isOk;
+}
+
+// =============================================================================
+// RegionStore Class
+// =============================================================================
+// Loads and saves chunks in region files under a directory.  load() may be
+// called from any thread.  save() only queues the chunk; a background writer
+// thread writes it, and loads of a chunk still queued are served from the
+// queue.  The destructor finishes every queued write.
+class RegionStore {
+    public:
+        RegionStore(const std::string& directory = REGION_DIRECTORY);
+        ~RegionStore();
+        RegionStore(const RegionStore&) = delete;
+        RegionStore& operator=(const RegionStore&) = delete;
+        bool load(Chunk& chunk);
+        void save(const Chunk& chunk);
+        void flush();
+
+    private:
+        struct Write {
+            Chunk chunk;
+            bool isQueued = false;
+        };
+
+        void work();
+        RegionFile& getRegion(int rx, int ry);
+        static int getRegionIndex(vec2i_t pos, int& rx, int& ry);
+        static std::uint64_t key(int a, int b);
+
+        std::string directory;
+
+        std::mutex regionsMutex;
+        std::unordered_map<std::uint64_t, std::unique_ptr<RegionFile>> regions;
+
+        bool isRunning = true;
+        std::mutex writesMutex;
+        std::condition_variable writesCondition;
+        std::condition_variable flushedCondition;
+        std::deque<std::uint64_t> writeOrder;
+        std::unordered_map<std::uint64_t, Write> writes;
+        int numWriting = 0;
+        std::thread writer;
+};
+
+// =============================================================================
+// Construct RegionStore
+// =============================================================================
+RegionStore::RegionStore(const std::string& directory) : directory(directory) {
+
+    std::error_code err;
+    std::filesystem::create_directories(directory, err);
+    if (err) {
+        std::cout << "WARNING: could not create save directory " << directory << std::endl;
+    }
+
+    writer = std::thread(&RegionStore::work, this);
+}
+
+// =============================================================================
+// Destruct RegionStore
+// =============================================================================
+RegionStore::~RegionStore() {
+    {
+        std::lock_guard<std::mutex> lock(writesMutex);
+        isRunning = false;
+    }
+    writesCondition.notify_all();
+    writer.join();
+}
+
+// =============================================================================
+// Load Chunk
+// =============================================================================
+bool RegionStore::load(Chunk& chunk) {
+
+    vec2i_t pos = chunk.getPosition();
+
+    // chunks waiting to be written are newer than the file
+    {
+        std::lock_guard<std::mutex> lock(writesMutex);
+        auto i = writes.find(key(pos.x, pos.y));
+        if (i != writes.end()) {
+            chunk.loadStorage(i->second.chunk.getStorage());
+            return true;
+        }
+    }
+
+    int rx, ry;
+    int index = getRegionIndex(pos, rx, ry);
+
+    TileArray2D tiles;
+    {
+        std::lock_guard<std::mutex> lock(regionsMutex);
+        if (!getRegion(rx, ry).read(index, tiles)) {
+            return false;
+        }
+    }
+
+    chunk.loadData(tiles);
+    return true;
+}
+
+// =============================================================================
+// Save Chunk
+// =============================================================================
+void RegionStore::save(const Chunk& chunk) {
+
+    vec2i_t pos = chunk.getPosition();
+    std::uint64_t k = key(pos.x, pos.y);
+    {
+        std::lock_guard<std::mutex> lock(writesMutex);
+
+        // a chunk saved twice before being written is only written once
+        Write& w = writes[k];
+        w.chunk = chunk;
+        if (!w.isQueued) {
+            w.isQueued = true;
+            writeOrder.push_back(k);
+        }
+    }
+    writesCondition.notify_one();
+}
+
+// =============================================================================
+// Flush
+// =============================================================================
+// Blocks until every queued chunk has been written.
+void RegionStore::flush() {
+    std::unique_lock<std::mutex> lock(writesMutex);
+    flushedCondition.wait(lock, [this] { return writeOrder.empty() && numWriting == 0; });
+}
+
+// =============================================================================
+// Work
+// =============================================================================
+// Writer thread.  Queued writes are finished even when stopping.
+void RegionStore::work() {
+    for (;;) {
+        Chunk chunk;
+        std::uint64_t k;
+        TileArray2D tiles;
+        std::vector<std::uint8_t> record;
+        {
+            std::unique_lock<std::mutex> lock(writesMutex);
+            writesCondition.wait(lock, [this] { return !isRunning || !writeOrder.empty(); });
+            if (writeOrder.empty()) {
+                return;
+            }
+            k = writeOrder.front();
+            writeOrder.pop_front();
+
+            Write& w = writes.at(k);
+            w.isQueued = false;
+            chunk = w.chunk;
+            numWriting++;
+        }
+
+        vec2i_t pos = chunk.getPosition();
+        int rx, ry;
+        int index = getRegionIndex(pos, rx, ry);
+
+        chunk.getData(tiles);
+        encodeTilesRLE(tiles, record);
+
+        bool isOk;
+        {
+            std::lock_guard<std::mutex> lock(regionsMutex);
+            isOk = getRegion(rx, ry).write(index, record);
+        }
+        if (!isOk) {
+            std::cout << "WARNING: could not save chunk " << pos.x << ", " << pos.y << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(writesMutex);
+
+            // a chunk saved again while being written stays queued
+            if (!writes.at(k).isQueued) {
+                writes.erase(k);
+            }
+            numWriting--;
+        }
+        flushedCondition.notify_all();
+    }
+}
+
+// =============================================================================
+// Get Region
+// =============================================================================
+// Caller must hold regionsMutex.
+RegionFile& RegionStore::getRegion(int rx, int ry) {
+
+    std::uint64_t k = key(rx, ry);
+    auto i = regions.find(k);
+    if (i != regions.end()) {
+        return *i->second;
+    }
+
+    // keep a bounded number of regions mapped
+    if (regions.size() >= REGION_CACHE_SIZE) {
+        regions.erase(regions.begin());
+    }
+
+    std::string filepath = directory + "/r." + std::to_string(rx) + "." + std::to_string(ry) + ".region";
+    return *regions.emplace(k, std::unique_ptr<RegionFile>(new RegionFile(filepath))).first->second;
+}
+
+// =============================================================================
+// Get Region Index
+// =============================================================================
+// Returns the chunk's index in its region's offset table.
+int RegionStore::getRegionIndex(vec2i_t pos, int& rx, int& ry) {
+
+    // floor division so negative chunks map to negative regions
+    rx = (pos.x >= 0) ? pos.x / REGION_CHUNKS_X : -((-pos.x - 1) / REGION_CHUNKS_X) - 1;
+    ry = (pos.y >= 0) ? pos.y / REGION_CHUNKS_Y : -((-pos.y - 1) / REGION_CHUNKS_Y) - 1;
+
+    return (pos.y - ry * REGION_CHUNKS_Y) * REGION_CHUNKS_X + (pos.x - rx * REGION_CHUNKS_X);
+}
+
+// =============================================================================
+// Key
+// =============================================================================
+std::uint64_t RegionStore::key(int a, int b) {
+    return (std::uint64_t(std::uint32_t(a)) << 32) | std::uint64_t(std::uint32_t(b));
+}
+
+#endif // REGION_H
\ No newline at end of file
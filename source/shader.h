@@ -1,19 +1,42 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+// local includes
+#include "types.h"
+#include "asset_cache.h"
+#include "mapped_file.h"
+
 // thrid party includes
 #include <GL/glew.h>
 #include <SDL.h>
 
 // STL includes
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
-#include <fstream>
+#include <unordered_map>
 #include <vector>
 #include <string>
 
+// definitions
+#define SHADER_CACHE_PREFIX "shader_" // asset cache name prefix of program binaries
+
 // =============================================================================
 // Shader Class
 // =============================================================================
+// Linked program plus the locations of its active uniforms and blocks, looked
+// up once at link time so the draw loop never queries names.
+//
+// Linked programs are kept in the asset cache as program binaries keyed by
+// the stage sources and the driver, so later launches skip compilation.  A
+// binary the driver rejects (after a driver update, say) is rebuilt from
+// source.
+//
+// reload() swaps in a program rebuilt from changed sources, keeping the old
+// one if the new sources fail to compile.  Locations may change, so users
+// compare getRevision() and refetch them.
 class Shader {
     public:
         Shader() {};
@@ -28,14 +51,45 @@ class Shader {
             std::string fragFilepath);
 
         GLuint getProgId() { return progId; }; // TODO: should be reference?
+        bool isFromBinary() const { return hasLoadedBinary; };
+        int getRevision() const { return revision; }; // bumped by every successful reload()
+        bool reload();
+        std::vector<std::string> getFilepaths() const;
+
+        GLint getUniformLocation(const std::string& name) const;
+        GLuint getUniformBlockIndex(const std::string& name) const;
+        GLuint getStorageBlockIndex(const std::string& name) const;
+
+        void setUniform(GLint location, GLint value);
+        void setUniform(GLint location, GLfloat value);
+        void setUniform(GLint location, const vec2f_t& value);
+        void setUniform(GLint location, const vec3f_t& value);
+        void setUniform(GLint location, const mat4x4f_t& value);
+
+        template <typename T>
+        void setUniform(const std::string& name, const T& value) { setUniform(getUniformLocation(name), value); };
 
     private:
-        void loadGLSLFromFile(std::string filepath, GLuint& shader, GLuint type);
+        struct Stage {
+            GLenum type;
+            std::string filepath;
+        };
+
+        void build();
+        void readSources(std::vector<MappedFile>& sources, std::string& name, std::uint64_t& key);
+        bool compile(GLuint program, const std::vector<MappedFile>& sources);
+        bool loadBinary(GLuint program, const std::string& name, std::uint64_t key);
+        void storeBinary(GLuint program, const std::string& name, std::uint64_t key);
+        bool loadGLSLFromFile(const Stage& stage, const MappedFile& source, GLuint& shader);
+        void cacheLocations();
 
+        std::vector<Stage> stages;
+        int revision = 0;
         GLuint progId = 0;
-        GLuint vertShader = NULL;
-        GLuint geomShader = NULL;
-        GLuint fragShader = NULL;
+        bool hasLoadedBinary = false;
+        std::unordered_map<std::string, GLint> uniformLocations;
+        std::unordered_map<std::string, GLuint> uniformBlocks;
+        std::unordered_map<std::string, GLuint> storageBlocks;
 };
 
 // =============================================================================
@@ -45,13 +99,9 @@ Shader::Shader(
         std::string vertFilepath,
         std::string fragFilepath) {
 
-    progId = glCreateProgram();
-    loadGLSLFromFile(vertFilepath, vertShader, GL_VERTEX_SHADER);
-    loadGLSLFromFile(fragFilepath, fragShader, GL_FRAGMENT_SHADER);
-    glAttachShader(progId, vertShader);
-    glAttachShader(progId, fragShader);
-    glLinkProgram(progId);
-    glValidateProgram(progId);
+    stages.push_back({GL_VERTEX_SHADER, vertFilepath});
+    stages.push_back({GL_FRAGMENT_SHADER, fragFilepath});
+    build();
 }
 
 // =============================================================================
@@ -62,38 +112,210 @@ Shader::Shader(
         std::string geomFilepath,
         std::string fragFilepath) {
 
+    stages.push_back({GL_VERTEX_SHADER, vertFilepath});
+    stages.push_back({GL_GEOMETRY_SHADER, geomFilepath});
+    stages.push_back({GL_FRAGMENT_SHADER, fragFilepath});
+    build();
+}
+
+// =============================================================================
+// Build
+// =============================================================================
+// Startup build.  There is no previous program to fall back on, so errors
+// are fatal.
+void Shader::build() {
+
+    std::vector<MappedFile> sources(stages.size());
+    std::string name;
+    std::uint64_t key;
+    readSources(sources, name, key);
+
     progId = glCreateProgram();
-    loadGLSLFromFile(vertFilepath, vertShader, GL_VERTEX_SHADER);
-    loadGLSLFromFile(geomFilepath, geomShader, GL_GEOMETRY_SHADER);
-    loadGLSLFromFile(fragFilepath, fragShader, GL_FRAGMENT_SHADER);
-    glAttachShader(progId, vertShader);
-    glAttachShader(progId, geomShader);
-    glAttachShader(progId, fragShader);
-    glLinkProgram(progId);
+    hasLoadedBinary = loadBinary(progId, name, key);
+
+    if (!hasLoadedBinary) {
+        if (!compile(progId, sources)) {
+            exit(1);
+        }
+        storeBinary(progId, name, key);
+    }
+
     glValidateProgram(progId);
+    cacheLocations();
 }
 
 // =============================================================================
-// Load GLSL From File
+// Reload
+// =============================================================================
+// Rebuilds the program from the current sources.  The new program replaces
+// the old one only if it compiles and links; otherwise the last good
+// program keeps running and false is returned.  Must be called on the
+// OpenGL thread.
+bool Shader::reload() {
+
+    std::vector<MappedFile> sources(stages.size());
+    std::string name;
+    std::uint64_t key;
+    readSources(sources, name, key);
+
+    GLuint program = glCreateProgram();
+    if (!compile(program, sources)) {
+        glDeleteProgram(program);
+        std::cout << "WARNING: keeping the previous program of " << stages.front().filepath << std::endl;
+        return false;
+    }
+    storeBinary(program, name, key);
+
+    glDeleteProgram(progId);
+    progId = program;
+    hasLoadedBinary = false;
+    revision++;
+    cacheLocations();
+    return true;
+}
+
+// =============================================================================
+// Get Filepaths
+// =============================================================================
+std::vector<std::string> Shader::getFilepaths() const {
+    std::vector<std::string> filepaths;
+    for (const Stage& stage : stages) {
+        filepaths.push_back(stage.filepath);
+    }
+    return filepaths;
+}
+
 // =============================================================================
-void Shader::loadGLSLFromFile(std::string filepath, GLuint& shader, GLuint type) {
+// Read Sources
+// =============================================================================
+// Maps every stage source.  The cache name follows the stage files, the key
+// their contents and the driver that compiles them.
+void Shader::readSources(std::vector<MappedFile>& sources, std::string& name, std::uint64_t& key) {
 
-    // read shader source from file
-    std::string line = "";
-    std::string source = "";
-    std::ifstream file(filepath.c_str());
+    std::uint64_t nameHash = ASSET_HASH_SEED;
+    key = ASSET_HASH_SEED;
+    for (size_t i = 0; i < stages.size(); i++) {
+        nameHash = AssetCache::hash(stages[i].filepath.data(), stages[i].filepath.size(), nameHash);
+        if (sources[i].open(stages[i].filepath)) {
+            key = AssetCache::hash(sources[i].getData(), sources[i].getSize(), key);
+        }
+        else {
+            std::cout << "ERROR: shader could not be read from " << stages[i].filepath << std::endl;
+        }
+    }
 
-    if(file.is_open()) {
-        while(std::getline(file, line)) {
-            source += line + "\n";
+    const GLenum driverStrings[3] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (GLenum s : driverStrings) {
+        const char* str = (const char*)glGetString(s);
+        if (str != nullptr) {
+            key = AssetCache::hash(str, std::strlen(str), key);
         }
-        file.close();
     }
 
-    // load and compile shader
-    shader = glCreateShader(type);
-    const char* src = source.c_str();
-    glShaderSource(shader, 1, &src, nullptr);
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), SHADER_CACHE_PREFIX "%016llx", (unsigned long long)nameHash);
+    name = buffer;
+}
+
+// =============================================================================
+// Compile
+// =============================================================================
+// Compiles every stage and links them into program.  Prints the log and
+// returns false on failure.
+bool Shader::compile(GLuint program, const std::vector<MappedFile>& sources) {
+
+    std::vector<GLuint> shaders;
+    bool isOk = true;
+    for (size_t i = 0; i < stages.size() && isOk; i++) {
+        GLuint shader = 0;
+        isOk = loadGLSLFromFile(stages[i], sources[i], shader);
+        if (isOk) {
+            glAttachShader(program, shader);
+            shaders.push_back(shader);
+        }
+    }
+
+    if (isOk) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(program);
+    }
+
+    // the program keeps the compiled code
+    for (GLuint shader : shaders) {
+        glDetachShader(program, shader);
+        glDeleteShader(shader);
+    }
+    if (!isOk) {
+        return false;
+    }
+
+    GLint result;
+    glGetProgramiv(program, GL_LINK_STATUS, &result);
+    if (result == GL_FALSE) {
+        int length;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::vector<char> errorMessages(size_t(length) + 1, '\0');
+        glGetProgramInfoLog(program, length, &length, errorMessages.data());
+
+        std::cout << "ERROR: shader linking failed." << std::endl
+                  << stages.front().filepath << std::endl
+                  << errorMessages.data() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// =============================================================================
+// Load Binary
+// =============================================================================
+// Blob: binary format, then the program binary.
+bool Shader::loadBinary(GLuint program, const std::string& name, std::uint64_t key) {
+
+    AssetCache cache;
+    AssetBlob blob;
+    if (!cache.load(name, key, blob) || blob.getSize() <= sizeof(GLenum)) {
+        return false;
+    }
+
+    GLenum format;
+    std::memcpy(&format, blob.getData(), sizeof(GLenum));
+    glProgramBinary(program, format, blob.getData() + sizeof(GLenum), GLsizei(blob.getSize() - sizeof(GLenum)));
+
+    GLint result;
+    glGetProgramiv(program, GL_LINK_STATUS, &result);
+    return result == GL_TRUE;
+}
+
+// =============================================================================
+// Store Binary
+// =============================================================================
+void Shader::storeBinary(GLuint program, const std::string& name, std::uint64_t key) {
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<std::uint8_t> blob(sizeof(GLenum) + size_t(length));
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, blob.data() + sizeof(GLenum));
+    std::memcpy(blob.data(), &format, sizeof(GLenum));
+
+    AssetCache cache;
+    cache.store(name, key, blob.data(), sizeof(GLenum) + size_t(length));
+}
+
+// =============================================================================
+// Load GLSL From File
+// =============================================================================
+bool Shader::loadGLSLFromFile(const Stage& stage, const MappedFile& source, GLuint& shader) {
+
+    // compile the mapped source in place
+    shader = glCreateShader(stage.type);
+    const char* src = source.getData() != nullptr ? (const char*)source.getData() : "";
+    GLint length = GLint(source.getSize());
+    glShaderSource(shader, 1, &src, &length);
     glCompileShader(shader);
 
     // error check shader
@@ -107,13 +329,110 @@ void Shader::loadGLSLFromFile(std::string filepath, GLuint& shader, GLuint type)
         glGetShaderInfoLog(shader, length, &length, errorMessages);
 
         std::cout << "ERROR: shader compilation failed." << std::endl
-                  << filepath << std::endl
+                  << stage.filepath << std::endl
                   << errorMessages << std::endl;
 
         delete[] errorMessages;
         glDeleteShader(shader);
-        exit(1);
+        shader = 0;
+        return false;
+    }
+    return true;
+}
+
+// =============================================================================
+// Cache Locations
+// =============================================================================
+// Records every active uniform, uniform block, and storage block by name.
+void Shader::cacheLocations() {
+
+    uniformLocations.clear();
+    uniformBlocks.clear();
+    storageBlocks.clear();
+
+    GLint maxLength = 0;
+    glGetProgramInterfaceiv(progId, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxLength);
+    std::vector<char> nameBuffer(size_t(std::max(maxLength, 1)));
+
+    GLint numUniforms = 0;
+    glGetProgramInterfaceiv(progId, GL_UNIFORM, GL_ACTIVE_RESOURCES, &numUniforms);
+    for (GLint i = 0; i < numUniforms; i++) {
+        GLsizei length = 0;
+        glGetProgramResourceName(progId, GL_UNIFORM, GLuint(i), GLsizei(nameBuffer.size()), &length, nameBuffer.data());
+        std::string name(nameBuffer.data(), size_t(length));
+
+        // members of blocks have no location
+        GLint location = glGetProgramResourceLocation(progId, GL_UNIFORM, name.c_str());
+        if (location >= 0) {
+            uniformLocations[name] = location;
+        }
     }
+
+    const GLenum blockInterfaces[2] = {GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK};
+    for (GLenum blockInterface : blockInterfaces) {
+        std::unordered_map<std::string, GLuint>& blocks =
+            blockInterface == GL_UNIFORM_BLOCK ? uniformBlocks : storageBlocks;
+
+        glGetProgramInterfaceiv(progId, blockInterface, GL_MAX_NAME_LENGTH, &maxLength);
+        nameBuffer.assign(size_t(std::max(maxLength, 1)), '\0');
+
+        GLint numBlocks = 0;
+        glGetProgramInterfaceiv(progId, blockInterface, GL_ACTIVE_RESOURCES, &numBlocks);
+        for (GLint i = 0; i < numBlocks; i++) {
+            GLsizei length = 0;
+            glGetProgramResourceName(progId, blockInterface, GLuint(i), GLsizei(nameBuffer.size()), &length, nameBuffer.data());
+            blocks[std::string(nameBuffer.data(), size_t(length))] = GLuint(i);
+        }
+    }
+}
+
+// =============================================================================
+// Get Uniform Location
+// =============================================================================
+// -1 for names that are not active uniforms; setters ignore -1 like GL does.
+GLint Shader::getUniformLocation(const std::string& name) const {
+    auto it = uniformLocations.find(name);
+    return it != uniformLocations.end() ? it->second : -1;
+}
+
+// =============================================================================
+// Get Uniform Block Index
+// =============================================================================
+GLuint Shader::getUniformBlockIndex(const std::string& name) const {
+    auto it = uniformBlocks.find(name);
+    return it != uniformBlocks.end() ? it->second : GL_INVALID_INDEX;
+}
+
+// =============================================================================
+// Get Storage Block Index
+// =============================================================================
+GLuint Shader::getStorageBlockIndex(const std::string& name) const {
+    auto it = storageBlocks.find(name);
+    return it != storageBlocks.end() ? it->second : GL_INVALID_INDEX;
+}
+
+// =============================================================================
+// Set Uniform
+// =============================================================================
+// Direct state access, so the program does not need to be bound.
+void Shader::setUniform(GLint location, GLint value) {
+    glProgramUniform1i(progId, location, value);
+}
+
+void Shader::setUniform(GLint location, GLfloat value) {
+    glProgramUniform1f(progId, location, value);
+}
+
+void Shader::setUniform(GLint location, const vec2f_t& value) {
+    glProgramUniform2fv(progId, location, 1, value.raw);
+}
+
+void Shader::setUniform(GLint location, const vec3f_t& value) {
+    glProgramUniform3fv(progId, location, 1, value.raw);
+}
+
+void Shader::setUniform(GLint location, const mat4x4f_t& value) {
+    glProgramUniformMatrix4fv(progId, location, 1, GL_FALSE, value.flat);
 }
 
 #endif // SHADER_H
\ No newline at end of file
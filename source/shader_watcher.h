@@ -0,0 +1,236 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+// local includes
+#include "shader.h"
+
+// third party includes
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// STL includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// definitions
+#define SHADER_WATCH_POLL_MS 100 // wake up interval of the watcher thread
+
+// =============================================================================
+// ShaderWatcher Class
+// =============================================================================
+// Reloads shaders when their source files change.  A background thread
+// watches the directories of every watched stage file (inotify on Linux,
+// modification time polling elsewhere) and queues changed paths; update()
+// runs on the OpenGL thread and calls Shader::reload() once per affected
+// shader, which keeps the last good program if the new source fails.
+class ShaderWatcher {
+    public:
+        ShaderWatcher();
+        ~ShaderWatcher();
+        ShaderWatcher(const ShaderWatcher&) = delete;
+        ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+        void watch(Shader& shader);
+        int update();
+
+    private:
+        static std::string normalize(const std::string& filepath);
+        void run();
+        void push(const std::string& filepath);
+
+        std::vector<std::pair<std::string, Shader*>> files; // GL thread only
+
+        // shared with the watcher thread
+        std::mutex mutex;
+        std::vector<std::string> changed;
+#ifdef __linux__
+        int fd = -1;
+        std::unordered_map<int, std::string> directories; // watch descriptor to path
+#else
+        std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes;
+#endif
+
+        // declared last so the thread starts after everything it uses
+        std::atomic<bool> isStopping;
+        std::thread thread;
+};
+
+// =============================================================================
+// Construct ShaderWatcher
+// =============================================================================
+ShaderWatcher::ShaderWatcher() : isStopping(false) {
+#ifdef __linux__
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        std::cout << "WARNING: shader hot reload disabled, inotify unavailable" << std::endl;
+        return;
+    }
+#endif
+    thread = std::thread([this] { run(); });
+}
+
+// =============================================================================
+// Destruct ShaderWatcher
+// =============================================================================
+ShaderWatcher::~ShaderWatcher() {
+    isStopping = true;
+    if (thread.joinable()) {
+        thread.join();
+    }
+#ifdef __linux__
+    if (fd >= 0) {
+        close(fd);
+    }
+#endif
+}
+
+// =============================================================================
+// Watch
+// =============================================================================
+// The shader must outlive the watcher or at least its last update().
+void ShaderWatcher::watch(Shader& shader) {
+
+    for (const std::string& filepath : shader.getFilepaths()) {
+        std::string file = normalize(filepath);
+        files.push_back({file, &shader});
+
+        std::lock_guard<std::mutex> lock(mutex);
+#ifdef __linux__
+        if (fd < 0) {
+            continue;
+        }
+
+        // editors often replace files by renaming, so watch the directory
+        std::string directory = std::filesystem::path(file).parent_path().generic_string();
+        int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd < 0) {
+            std::cout << "WARNING: could not watch shader directory " << directory << std::endl;
+            continue;
+        }
+        directories[wd] = directory;
+#else
+        std::error_code err;
+        writeTimes[file] = std::filesystem::last_write_time(file, err);
+#endif
+    }
+}
+
+// =============================================================================
+// Update
+// =============================================================================
+// Reloads every shader with a changed stage file.  Returns the number of
+// shaders reloaded successfully.
+int ShaderWatcher::update() {
+
+    std::vector<std::string> paths;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (changed.empty()) {
+            return 0;
+        }
+        paths.swap(changed);
+    }
+
+    // one save can report several events, reload each shader only once
+    std::vector<Shader*> shaders;
+    for (const std::string& path : paths) {
+        for (const std::pair<std::string, Shader*>& file : files) {
+            if (file.first == path &&
+                std::find(shaders.begin(), shaders.end(), file.second) == shaders.end()) {
+                shaders.push_back(file.second);
+            }
+        }
+    }
+
+    int numReloaded = 0;
+    for (Shader* shader : shaders) {
+        if (shader->reload()) {
+            std::cout << "reloaded shader " << shader->getFilepaths().front() << std::endl;
+            numReloaded++;
+        }
+    }
+    return numReloaded;
+}
+
+// =============================================================================
+// Normalize
+// =============================================================================
+std::string ShaderWatcher::normalize(const std::string& filepath) {
+    return std::filesystem::path(filepath).lexically_normal().generic_string();
+}
+
+// =============================================================================
+// Push
+// =============================================================================
+void ShaderWatcher::push(const std::string& filepath) {
+    std::lock_guard<std::mutex> lock(mutex);
+    changed.push_back(filepath);
+}
+
+// =============================================================================
+// Run
+// =============================================================================
+// Watcher thread.  Wakes up at least every SHADER_WATCH_POLL_MS to notice
+// isStopping.
+void ShaderWatcher::run() {
+#ifdef __linux__
+    alignas(struct inotify_event) char buffer[4096];
+
+    while (!isStopping) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, SHADER_WATCH_POLL_MS) <= 0) {
+            continue;
+        }
+
+        ssize_t length;
+        while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + length;) {
+                const struct inotify_event* event = (const struct inotify_event*)p;
+                p += sizeof(struct inotify_event) + event->len;
+                if (event->len == 0) {
+                    continue;
+                }
+
+                std::string directory;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    auto it = directories.find(event->wd);
+                    if (it == directories.end()) {
+                        continue;
+                    }
+                    directory = it->second;
+                }
+                push(directory + "/" + event->name);
+            }
+        }
+    }
+#else
+    while (!isStopping) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(SHADER_WATCH_POLL_MS));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& file : writeTimes) {
+            std::error_code err;
+            std::filesystem::file_time_type time = std::filesystem::last_write_time(file.first, err);
+            if (!err && time != file.second) {
+                file.second = time;
+                changed.push_back(file.first);
+            }
+        }
+    }
+#endif
+}
+
+#endif // SHADER_WATCHER_H
@@ -0,0 +1,245 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+// local includes
+#include "types.h"
+#include "ecs.h"
+#include "path_service.h"
+#include "units.h"
+
+// STL includes
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// definitions
+#define SIMULATION_TICK_RATE 30 // ticks per second
+#define SIMULATION_MAX_STEPS 5 // ticks caught up at once before dropping time
+#define SIMULATION_UNIT_SPEED 64.0f // pixels per second, per axis at most
+#define SIMULATION_UNIT_EXTENT 4096.0f // units roam the square of this half size
+
+// =============================================================================
+// SimState Struct
+// =============================================================================
+// Everything rendering needs from one tick.  Copied by value when published,
+// so keep it small.
+struct SimState {
+    std::uint64_t tick = 0;
+    vec2f_t cameraPos = {{0.0f, 0.0f}};
+    size_t numUnits = 0;
+    float stepMs = 0.0f; // cost of the last tick
+};
+
+// =============================================================================
+// Simulation Class
+// =============================================================================
+// Fixed timestep simulation on its own thread.  Real time accumulates and is
+// consumed in steps of exactly 1 / SIMULATION_TICK_RATE seconds, so results
+// do not depend on the frame rate; after a stall at most
+// SIMULATION_MAX_STEPS ticks are caught up and the rest is dropped.
+//
+// Input is sampled at the start of each tick.  After every batch of ticks
+// the previous and current states are written to the back of a double
+// buffer and swapped to the front; getRenderState() copies the front under
+// a short lock and returns how far rendering is between the two, so the
+// render thread never waits for a tick and vice versa.  Rendering shows the
+// world one tick late.
+//
+// Units live in an ECS world owned by the simulation thread; step() runs the
+// unit systems over it once per tick.  Each tick starts with a tick
+// boundary of the path service, so path results only change between ticks.
+class Simulation {
+    public:
+        Simulation() {};
+        ~Simulation();
+        Simulation(const Simulation&) = delete;
+        Simulation& operator=(const Simulation&) = delete;
+        void start(const SimState& initial, int numUnits = 0, std::uint32_t seed = 0);
+        void stop();
+        void setCameraVelocity(vec2f_t velocity);
+        float getRenderState(SimState& prev, SimState& curr);
+        static float getTickSeconds() { return 1.0f / SIMULATION_TICK_RATE; };
+        PathService& getPathService() { return paths; };
+
+    private:
+        typedef std::chrono::steady_clock clock;
+
+        struct Published {
+            SimState prev;
+            SimState curr;
+            clock::time_point time; // when curr was published
+        };
+
+        void run();
+        void step();
+        void publish();
+
+        // simulation thread only
+        SimState state;
+        SimState statePrev;
+        vec2f_t cameraVel = {{0.0f, 0.0f}}; // pixels per second
+        World world;
+
+        // thread safe, synced by the thread owning the chunks
+        PathService paths;
+
+        // shared with the render thread
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool isRunning = false;
+        vec2f_t cameraVelInput = {{0.0f, 0.0f}};
+        Published published[2];
+        int front = 0;
+
+        std::thread thread;
+};
+
+// =============================================================================
+// Destruct Simulation
+// =============================================================================
+Simulation::~Simulation() {
+    stop();
+}
+
+// =============================================================================
+// Start
+// =============================================================================
+void Simulation::start(const SimState& initial, int numUnits, std::uint32_t seed) {
+    stop();
+
+    world.clear();
+    UnitSystems::spawn(world, numUnits, SIMULATION_UNIT_EXTENT, SIMULATION_UNIT_SPEED, seed);
+
+    state = initial;
+    state.numUnits = world.size();
+    statePrev = state;
+    published[front] = {state, state, clock::now()};
+    isRunning = true;
+    thread = std::thread(&Simulation::run, this);
+}
+
+// =============================================================================
+// Stop
+// =============================================================================
+void Simulation::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isRunning = false;
+    }
+    condition.notify_all();
+
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+// =============================================================================
+// Set Camera Velocity
+// =============================================================================
+// Pixels per second, applied from the next tick on.
+void Simulation::setCameraVelocity(vec2f_t velocity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    cameraVelInput = velocity;
+}
+
+// =============================================================================
+// Get Render State
+// =============================================================================
+// Copies the two latest ticks and returns the interpolation factor between
+// them, 0 at prev and 1 at curr.
+float Simulation::getRenderState(SimState& prev, SimState& curr) {
+    clock::time_point time;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        prev = published[front].prev;
+        curr = published[front].curr;
+        time = published[front].time;
+    }
+
+    float elapsed = std::chrono::duration<float>(clock::now() - time).count();
+    return std::min(1.0f, std::max(0.0f, elapsed / getTickSeconds()));
+}
+
+// =============================================================================
+// Run
+// =============================================================================
+void Simulation::run() {
+
+    const clock::duration tick = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(1.0 / SIMULATION_TICK_RATE));
+    clock::time_point previous = clock::now();
+    clock::duration accumulator = clock::duration::zero();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (isRunning) {
+
+        // sample input once per batch; it holds for every tick in it
+        cameraVel = cameraVelInput;
+        lock.unlock();
+
+        clock::time_point now = clock::now();
+        accumulator += now - previous;
+        previous = now;
+
+        int numSteps = 0;
+        while (accumulator >= tick && numSteps < SIMULATION_MAX_STEPS) {
+            statePrev = state;
+            step();
+            accumulator -= tick;
+            numSteps++;
+        }
+
+        // too far behind to catch up, keep simulating from now
+        if (accumulator >= tick) {
+            accumulator = clock::duration::zero();
+        }
+
+        if (numSteps > 0) {
+            publish();
+        }
+
+        // sleep until the next tick is due, waking early on stop()
+        lock.lock();
+        condition.wait_until(lock, now + (tick - accumulator), [this] { return !isRunning; });
+    }
+}
+
+// =============================================================================
+// Step
+// =============================================================================
+// Advances the world by exactly one tick.
+void Simulation::step() {
+    clock::time_point beg = clock::now();
+    float dt = getTickSeconds();
+
+    paths.beginTick();
+
+    state.tick++;
+    state.cameraPos.x += cameraVel.x * dt;
+    state.cameraPos.y += cameraVel.y * dt;
+
+    UnitSystems::move(world, dt);
+    UnitSystems::confine(world, SIMULATION_UNIT_EXTENT);
+    UnitSystems::updateChunkCells(world);
+
+    state.numUnits = world.size();
+    state.stepMs = std::chrono::duration<float, std::milli>(clock::now() - beg).count();
+}
+
+// =============================================================================
+// Publish
+// =============================================================================
+void Simulation::publish() {
+
+    // the back buffer is never read, so it is filled without the lock
+    int back = 1 - front;
+    published[back] = {statePrev, state, clock::now()};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    front = back;
+}
+
+#endif // SIMULATION_H
@@ -0,0 +1,405 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+// local includes
+#include "types.h"
+#include "chunk.h"
+
+// third party includes
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TERRAIN_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TERRAIN_SIMD_SSE2
+#endif
+
+// STL includes
+#include <cmath>
+#include <cstdint>
+
+// definitions
+#define TERRAIN_OCTAVES 5
+#define TERRAIN_FREQUENCY (1.0f / 64.0f) // per tile
+#define TERRAIN_LACUNARITY 2.0f
+#define TERRAIN_GAIN 0.5f
+#define TERRAIN_MOISTURE_SEED_OFFSET 7919
+#define TERRAIN_MOISTURE_FREQUENCY (1.0f / 128.0f)
+
+// biome thresholds on the normalized height and moisture
+#define TERRAIN_WATER_LEVEL -0.15f
+#define TERRAIN_SAND_LEVEL -0.08f
+#define TERRAIN_FOREST_MOISTURE 0.1f
+
+// hashing constants (same primes as FastNoiseLite)
+#define TERRAIN_PRIME_X 501125321
+#define TERRAIN_PRIME_Y 1136930381
+#define TERRAIN_HASH_MUL 0x27d4eb2d
+
+// =============================================================================
+// TerrainGenerator Class
+// =============================================================================
+// Fills chunks from a seed: a multi-octave gradient noise heightmap plus a
+// moisture map, mapped to tile ids per biome.  Noise is evaluated for a whole
+// chunk row at once; every lane of a row shares y, so only the x lattice work
+// is vectorized (8 lanes with AVX2, 4 with SSE2, scalar elsewhere).  Every
+// path evaluates the same operations in the same order as fbmRowScalar.
+// generate() is const and safe to call from any number of worker threads.
+class TerrainGenerator {
+    public:
+        TerrainGenerator(unsigned int seed = 0) { setSeed(seed); };
+        void setSeed(unsigned int seed) { this->seed = std::int32_t(seed); };
+        void setSimd(bool isSimd) { this->isSimd = isSimd; };
+        void generate(Chunk& chunk) const;
+        static const char* getKernelName();
+
+    private:
+        static void fbmRow(std::int32_t seed, float x, float y, float freq, float* out);
+        static void fbmRowScalar(std::int32_t seed, float x, float y, float freq, float* out);
+        static float gradientScalar(std::int32_t seed, std::int32_t xp, std::int32_t yp, float dx, float dy);
+
+        std::int32_t seed = 0;
+        bool isSimd = true;
+};
+
+// =============================================================================
+// Generate
+// =============================================================================
+void TerrainGenerator::generate(Chunk& chunk) const {
+
+    vec2i_t pos = chunk.getPosition();
+    TileArray2D tiles;
+
+    float height[CHUNK_TILES_X];
+    float moisture[CHUNK_TILES_X];
+
+    // tile coordinates of the chunk's first tile
+    float x = float(pos.x * CHUNK_TILES_X);
+    float yBeg = float(pos.y * CHUNK_TILES_Y);
+
+    for (int y = 0; y < CHUNK_TILES_Y; y++) {
+        float ty = yBeg + float(y);
+
+        if (isSimd) {
+            fbmRow(seed, x, ty, TERRAIN_FREQUENCY, height);
+            fbmRow(seed + TERRAIN_MOISTURE_SEED_OFFSET, x, ty, TERRAIN_MOISTURE_FREQUENCY, moisture);
+        }
+        else {
+            fbmRowScalar(seed, x, ty, TERRAIN_FREQUENCY, height);
+            fbmRowScalar(seed + TERRAIN_MOISTURE_SEED_OFFSET, x, ty, TERRAIN_MOISTURE_FREQUENCY, moisture);
+        }
+
+        // map biomes to tile ids
+        for (int x = 0; x < CHUNK_TILES_X; x++) {
+            std::uint8_t tile;
+            if (height[x] < TERRAIN_WATER_LEVEL) {
+                tile = TILE_WATER;
+            }
+            else if (height[x] < TERRAIN_SAND_LEVEL) {
+                tile = TILE_SAND;
+            }
+            else if (moisture[x] > TERRAIN_FOREST_MOISTURE) {
+                tile = TILE_FOREST;
+            }
+            else {
+                tile = TILE_GRASS;
+            }
+            tiles[y][x] = tile;
+        }
+    }
+
+    chunk.loadData(tiles);
+}
+
+// =============================================================================
+// Get Kernel Name
+// =============================================================================
+const char* TerrainGenerator::getKernelName() {
+#if defined(TERRAIN_SIMD_AVX2)
+    return "avx2";
+#elif defined(TERRAIN_SIMD_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+// =============================================================================
+// Gradient (Scalar)
+// =============================================================================
+// Dot product of the offset with a hashed diagonal gradient.  The top two
+// hash bits flip the signs of dx and dy.
+float TerrainGenerator::gradientScalar(
+        std::int32_t seed,
+        std::int32_t xp,
+        std::int32_t yp,
+        float dx,
+        float dy) {
+
+    std::uint32_t h = std::uint32_t(seed ^ xp ^ yp) * std::uint32_t(TERRAIN_HASH_MUL);
+    float gx = (h & 0x80000000u) ? -dx : dx;
+    float gy = (h & 0x40000000u) ? -dy : dy;
+    return gx + gy;
+}
+
+// =============================================================================
+// FBM Row (Scalar)
+// =============================================================================
+void TerrainGenerator::fbmRowScalar(std::int32_t seed, float x, float y, float freq, float* out) {
+
+    for (int i = 0; i < CHUNK_TILES_X; i++) {
+        out[i] = 0.0f;
+    }
+
+    float amp = 1.0f;
+    float ampSum = 0.0f;
+
+    for (int o = 0; o < TERRAIN_OCTAVES; o++) {
+        std::int32_t s = seed + o;
+
+        // row values shared by every tile
+        float fy = y * freq;
+        float y0 = std::floor(fy);
+        float dy0 = fy - y0;
+        float v = dy0 * dy0 * dy0 * (dy0 * (dy0 * 6.0f - 15.0f) + 10.0f);
+        std::int32_t yp0 = std::int32_t(std::uint32_t(std::int32_t(y0)) * std::uint32_t(TERRAIN_PRIME_Y));
+        std::int32_t yp1 = std::int32_t(std::uint32_t(yp0) + std::uint32_t(TERRAIN_PRIME_Y));
+
+        for (int i = 0; i < CHUNK_TILES_X; i++) {
+            float fx = (x + float(i)) * freq;
+            float x0 = std::floor(fx);
+            float dx0 = fx - x0;
+            float u = dx0 * dx0 * dx0 * (dx0 * (dx0 * 6.0f - 15.0f) + 10.0f);
+            std::int32_t xp0 = std::int32_t(std::uint32_t(std::int32_t(x0)) * std::uint32_t(TERRAIN_PRIME_X));
+            std::int32_t xp1 = std::int32_t(std::uint32_t(xp0) + std::uint32_t(TERRAIN_PRIME_X));
+
+            float g00 = gradientScalar(s, xp0, yp0, dx0, dy0);
+            float g10 = gradientScalar(s, xp1, yp0, dx0 - 1.0f, dy0);
+            float g01 = gradientScalar(s, xp0, yp1, dx0, dy0 - 1.0f);
+            float g11 = gradientScalar(s, xp1, yp1, dx0 - 1.0f, dy0 - 1.0f);
+
+            float n0 = g00 + u * (g10 - g00);
+            float n1 = g01 + u * (g11 - g01);
+            out[i] += amp * (n0 + v * (n1 - n0));
+        }
+
+        ampSum += amp;
+        amp *= TERRAIN_GAIN;
+        freq *= TERRAIN_LACUNARITY;
+    }
+
+    // normalize to roughly [-1, 1]
+    float scale = 1.0f / ampSum;
+    for (int i = 0; i < CHUNK_TILES_X; i++) {
+        out[i] *= scale;
+    }
+}
+
+#if defined(TERRAIN_SIMD_AVX2)
+
+// =============================================================================
+// FBM Row (AVX2)
+// =============================================================================
+void TerrainGenerator::fbmRow(std::int32_t seed, float x, float y, float freq, float* out) {
+
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 six = _mm256_set1_ps(6.0f);
+    const __m256 fifteen = _mm256_set1_ps(15.0f);
+    const __m256 ten = _mm256_set1_ps(10.0f);
+    const __m256i signX = _mm256_set1_epi32(int(0x80000000u));
+    const __m256i primeX = _mm256_set1_epi32(TERRAIN_PRIME_X);
+    const __m256i hashMul = _mm256_set1_epi32(TERRAIN_HASH_MUL);
+    const __m256 lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+    __m256 sum[CHUNK_TILES_X / 8];
+    for (int b = 0; b < CHUNK_TILES_X / 8; b++) {
+        sum[b] = _mm256_setzero_ps();
+    }
+
+    float amp = 1.0f;
+    float ampSum = 0.0f;
+
+    for (int o = 0; o < TERRAIN_OCTAVES; o++) {
+        std::int32_t s = seed + o;
+
+        // row values shared by every lane
+        float fy = y * freq;
+        float y0 = std::floor(fy);
+        float dy0 = fy - y0;
+        float v = dy0 * dy0 * dy0 * (dy0 * (dy0 * 6.0f - 15.0f) + 10.0f);
+        std::int32_t yp0 = std::int32_t(std::uint32_t(std::int32_t(y0)) * std::uint32_t(TERRAIN_PRIME_Y));
+        std::int32_t yp1 = std::int32_t(std::uint32_t(yp0) + std::uint32_t(TERRAIN_PRIME_Y));
+
+        const __m256i seedY0 = _mm256_set1_epi32(s ^ yp0);
+        const __m256i seedY1 = _mm256_set1_epi32(s ^ yp1);
+        const __m256 dyA = _mm256_set1_ps(dy0);
+        const __m256 dyB = _mm256_set1_ps(dy0 - 1.0f);
+        const __m256 vv = _mm256_set1_ps(v);
+        const __m256 ff = _mm256_set1_ps(freq);
+        const __m256 aa = _mm256_set1_ps(amp);
+
+        for (int b = 0; b < CHUNK_TILES_X / 8; b++) {
+            __m256 fx = _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(x + float(b * 8)), lane), ff);
+            __m256 x0 = _mm256_floor_ps(fx);
+            __m256 dxA = _mm256_sub_ps(fx, x0);
+            __m256 dxB = _mm256_sub_ps(dxA, one);
+            __m256 u = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(dxA, dxA), dxA),
+                _mm256_add_ps(_mm256_mul_ps(dxA, _mm256_sub_ps(_mm256_mul_ps(dxA, six), fifteen)), ten));
+
+            __m256i xp0 = _mm256_mullo_epi32(_mm256_cvtps_epi32(x0), primeX);
+            __m256i xp1 = _mm256_add_epi32(xp0, primeX);
+
+            // hash each lattice corner; the top two bits flip the gradient
+            __m256i h00 = _mm256_mullo_epi32(_mm256_xor_si256(seedY0, xp0), hashMul);
+            __m256i h10 = _mm256_mullo_epi32(_mm256_xor_si256(seedY0, xp1), hashMul);
+            __m256i h01 = _mm256_mullo_epi32(_mm256_xor_si256(seedY1, xp0), hashMul);
+            __m256i h11 = _mm256_mullo_epi32(_mm256_xor_si256(seedY1, xp1), hashMul);
+
+            #define TERRAIN_GRAD8(h, dx, dy) _mm256_add_ps( \
+                _mm256_xor_ps(dx, _mm256_castsi256_ps(_mm256_and_si256(h, signX))), \
+                _mm256_xor_ps(dy, _mm256_castsi256_ps(_mm256_and_si256(_mm256_slli_epi32(h, 1), signX))))
+
+            __m256 g00 = TERRAIN_GRAD8(h00, dxA, dyA);
+            __m256 g10 = TERRAIN_GRAD8(h10, dxB, dyA);
+            __m256 g01 = TERRAIN_GRAD8(h01, dxA, dyB);
+            __m256 g11 = TERRAIN_GRAD8(h11, dxB, dyB);
+
+            #undef TERRAIN_GRAD8
+
+            __m256 n0 = _mm256_add_ps(g00, _mm256_mul_ps(u, _mm256_sub_ps(g10, g00)));
+            __m256 n1 = _mm256_add_ps(g01, _mm256_mul_ps(u, _mm256_sub_ps(g11, g01)));
+            __m256 n = _mm256_add_ps(n0, _mm256_mul_ps(vv, _mm256_sub_ps(n1, n0)));
+            sum[b] = _mm256_add_ps(sum[b], _mm256_mul_ps(aa, n));
+        }
+
+        ampSum += amp;
+        amp *= TERRAIN_GAIN;
+        freq *= TERRAIN_LACUNARITY;
+    }
+
+    // normalize to roughly [-1, 1]
+    const __m256 scale = _mm256_set1_ps(1.0f / ampSum);
+    for (int b = 0; b < CHUNK_TILES_X / 8; b++) {
+        _mm256_storeu_ps(out + b * 8, _mm256_mul_ps(sum[b], scale));
+    }
+}
+
+#elif defined(TERRAIN_SIMD_SSE2)
+
+// =============================================================================
+// SSE2 Helpers
+// =============================================================================
+// SSE2 has neither a 32-bit low multiply nor a floor instruction.
+static inline __m128i terrainMulLo(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(
+        _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+        _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128i terrainFloorToInt(__m128 x) {
+    __m128i t = _mm_cvttps_epi32(x);
+    __m128 gt = _mm_cmpgt_ps(_mm_cvtepi32_ps(t), x); // truncated up for negatives
+    return _mm_add_epi32(t, _mm_castps_si128(gt));   // adds -1 where true
+}
+
+// =============================================================================
+// FBM Row (SSE2)
+// =============================================================================
+void TerrainGenerator::fbmRow(std::int32_t seed, float x, float y, float freq, float* out) {
+
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 six = _mm_set1_ps(6.0f);
+    const __m128 fifteen = _mm_set1_ps(15.0f);
+    const __m128 ten = _mm_set1_ps(10.0f);
+    const __m128i signX = _mm_set1_epi32(int(0x80000000u));
+    const __m128i primeX = _mm_set1_epi32(TERRAIN_PRIME_X);
+    const __m128i hashMul = _mm_set1_epi32(TERRAIN_HASH_MUL);
+    const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+    __m128 sum[CHUNK_TILES_X / 4];
+    for (int b = 0; b < CHUNK_TILES_X / 4; b++) {
+        sum[b] = _mm_setzero_ps();
+    }
+
+    float amp = 1.0f;
+    float ampSum = 0.0f;
+
+    for (int o = 0; o < TERRAIN_OCTAVES; o++) {
+        std::int32_t s = seed + o;
+
+        // row values shared by every lane
+        float fy = y * freq;
+        float y0 = std::floor(fy);
+        float dy0 = fy - y0;
+        float v = dy0 * dy0 * dy0 * (dy0 * (dy0 * 6.0f - 15.0f) + 10.0f);
+        std::int32_t yp0 = std::int32_t(std::uint32_t(std::int32_t(y0)) * std::uint32_t(TERRAIN_PRIME_Y));
+        std::int32_t yp1 = std::int32_t(std::uint32_t(yp0) + std::uint32_t(TERRAIN_PRIME_Y));
+
+        const __m128i seedY0 = _mm_set1_epi32(s ^ yp0);
+        const __m128i seedY1 = _mm_set1_epi32(s ^ yp1);
+        const __m128 dyA = _mm_set1_ps(dy0);
+        const __m128 dyB = _mm_set1_ps(dy0 - 1.0f);
+        const __m128 vv = _mm_set1_ps(v);
+        const __m128 ff = _mm_set1_ps(freq);
+        const __m128 aa = _mm_set1_ps(amp);
+
+        for (int b = 0; b < CHUNK_TILES_X / 4; b++) {
+            __m128 fx = _mm_mul_ps(_mm_add_ps(_mm_set1_ps(x + float(b * 4)), lane), ff);
+            __m128i ix = terrainFloorToInt(fx);
+            __m128 dxA = _mm_sub_ps(fx, _mm_cvtepi32_ps(ix));
+            __m128 dxB = _mm_sub_ps(dxA, one);
+            __m128 u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(dxA, dxA), dxA),
+                _mm_add_ps(_mm_mul_ps(dxA, _mm_sub_ps(_mm_mul_ps(dxA, six), fifteen)), ten));
+
+            __m128i xp0 = terrainMulLo(ix, primeX);
+            __m128i xp1 = _mm_add_epi32(xp0, primeX);
+
+            // hash each lattice corner; the top two bits flip the gradient
+            __m128i h00 = terrainMulLo(_mm_xor_si128(seedY0, xp0), hashMul);
+            __m128i h10 = terrainMulLo(_mm_xor_si128(seedY0, xp1), hashMul);
+            __m128i h01 = terrainMulLo(_mm_xor_si128(seedY1, xp0), hashMul);
+            __m128i h11 = terrainMulLo(_mm_xor_si128(seedY1, xp1), hashMul);
+
+            #define TERRAIN_GRAD4(h, dx, dy) _mm_add_ps( \
+                _mm_xor_ps(dx, _mm_castsi128_ps(_mm_and_si128(h, signX))), \
+                _mm_xor_ps(dy, _mm_castsi128_ps(_mm_and_si128(_mm_slli_epi32(h, 1), signX))))
+
+            __m128 g00 = TERRAIN_GRAD4(h00, dxA, dyA);
+            __m128 g10 = TERRAIN_GRAD4(h10, dxB, dyA);
+            __m128 g01 = TERRAIN_GRAD4(h01, dxA, dyB);
+            __m128 g11 = TERRAIN_GRAD4(h11, dxB, dyB);
+
+            #undef TERRAIN_GRAD4
+
+            __m128 n0 = _mm_add_ps(g00, _mm_mul_ps(u, _mm_sub_ps(g10, g00)));
+            __m128 n1 = _mm_add_ps(g01, _mm_mul_ps(u, _mm_sub_ps(g11, g01)));
+            __m128 n = _mm_add_ps(n0, _mm_mul_ps(vv, _mm_sub_ps(n1, n0)));
+            sum[b] = _mm_add_ps(sum[b], _mm_mul_ps(aa, n));
+        }
+
+        ampSum += amp;
+        amp *= TERRAIN_GAIN;
+        freq *= TERRAIN_LACUNARITY;
+    }
+
+    // normalize to roughly [-1, 1]
+    const __m128 scale = _mm_set1_ps(1.0f / ampSum);
+    for (int b = 0; b < CHUNK_TILES_X / 4; b++) {
+        _mm_storeu_ps(out + b * 4, _mm_mul_ps(sum[b], scale));
+    }
+}
+
+#else
+
+// =============================================================================
+// FBM Row
+// =============================================================================
+void TerrainGenerator::fbmRow(std::int32_t seed, float x, float y, float freq, float* out) {
+    fbmRowScalar(seed, x, y, freq, out);
+}
+
+#endif
+
+#endif // TERRAIN_H
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// STL includes
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// =============================================================================
+// ThreadPool Class
+// =============================================================================
+// Fixed set of worker threads running submitted jobs in FIFO order.  Jobs
+// still queued when the pool is destroyed are discarded.
+class ThreadPool {
+    public:
+        ThreadPool(int numThreads = 0);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        void submit(std::function<void()> job);
+        int getNumThreads() { return int(threads.size()); };
+
+    private:
+        void work();
+
+        bool isRunning = true;
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<std::function<void()>> jobs;
+        std::vector<std::thread> threads;
+};
+
+// =============================================================================
+// Construct ThreadPool
+// =============================================================================
+ThreadPool::ThreadPool(int numThreads) {
+
+    // default to one worker per core, leaving one core for the main thread
+    if (numThreads <= 0) {
+        numThreads = std::max(1, int(std::thread::hardware_concurrency()) - 1);
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+// =============================================================================
+// Destruct ThreadPool
+// =============================================================================
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isRunning = false;
+        jobs.clear();
+    }
+    condition.notify_all();
+
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+// =============================================================================
+// Submit
+// =============================================================================
+void ThreadPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    condition.notify_one();
+}
+
+// =============================================================================
+// Work
+// =============================================================================
+void ThreadPool::work() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return !isRunning || !jobs.empty(); });
+            if (!isRunning) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+#endif // THREAD_POOL_H
\ No newline at end of file
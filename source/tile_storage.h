@@ -0,0 +1,248 @@
+#ifndef TILE_STORAGE_H
+#define TILE_STORAGE_H
+
+// STL includes
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// definitions
+#define CHUNK_TILES_X 32
+#define CHUNK_TILES_Y 32
+#define CHUNK_TILES (CHUNK_TILES_X * CHUNK_TILES_Y)
+#define TILE_STORAGE_PALETTE_MAX 16 // distinct tiles before falling back to raw bytes
+#define TILE_STORAGE_RLE_RUN_MAX 256
+
+// type definitions
+typedef std::uint8_t TileArray2D [CHUNK_TILES_Y][CHUNK_TILES_X];
+
+// =============================================================================
+// TileStorage Class
+// =============================================================================
+// Palette compressed tile ids for one chunk.  Tiles are stored as indices
+// into a palette of up to 16 ids, packed 0, 1, 2, or 4 bits per tile
+// depending on how many distinct ids the chunk holds.  A uniform chunk needs
+// no tile words at all.  Chunks with more distinct ids store raw bytes.
+//
+// set() appends to the palette while the current width has room and repacks
+// otherwise; load() always picks the narrowest width.
+class TileStorage {
+    public:
+        TileStorage() { fill(0); };
+        void fill(std::uint8_t tile);
+        void load(const TileArray2D& tiles);
+        void store(TileArray2D& tiles) const;
+        inline std::uint8_t get(int i) const;
+        void set(int i, std::uint8_t tile);
+
+        bool isUniform() const { return bits == 0; };
+        int getBitsPerTile() const { return bits; };
+        int getPaletteSize() const { return bits == 8 ? 0 : paletteSize; };
+        size_t getMemoryUsage() const { return sizeof(TileStorage) + words.capacity() * sizeof(std::uint64_t); };
+
+    private:
+        int find(std::uint8_t tile) const;
+
+        std::uint8_t bits = 0; // 0, 1, 2, 4, or 8 (raw ids, no palette)
+        std::uint8_t paletteSize = 1;
+        std::uint8_t palette[TILE_STORAGE_PALETTE_MAX];
+        std::vector<std::uint64_t> words;
+};
+
+// =============================================================================
+// Fill
+// =============================================================================
+void TileStorage::fill(std::uint8_t tile) {
+    bits = 0;
+    paletteSize = 1;
+    palette[0] = tile;
+    words.clear();
+    words.shrink_to_fit();
+}
+
+// =============================================================================
+// Load
+// =============================================================================
+void TileStorage::load(const TileArray2D& tiles) {
+
+    const std::uint8_t* src = &tiles[0][0];
+
+    // build the palette in order of first appearance
+    std::uint8_t lut[256];
+    bool seen[256] = {};
+    int n = 0;
+    for (int i = 0; i < CHUNK_TILES && n <= TILE_STORAGE_PALETTE_MAX; i++) {
+        std::uint8_t tile = src[i];
+        if (!seen[tile]) {
+            seen[tile] = true;
+            if (n < TILE_STORAGE_PALETTE_MAX) {
+                palette[n] = tile;
+                lut[tile] = std::uint8_t(n);
+            }
+            n++;
+        }
+    }
+
+    if (n == 1) {
+        fill(src[0]);
+        return;
+    }
+
+    if (n <= 2) bits = 1;
+    else if (n <= 4) bits = 2;
+    else if (n <= TILE_STORAGE_PALETTE_MAX) bits = 4;
+    else bits = 8;
+    paletteSize = std::uint8_t(n <= TILE_STORAGE_PALETTE_MAX ? n : 0);
+
+    words.assign(CHUNK_TILES * bits / 64, 0);
+    words.shrink_to_fit();
+
+    int perWord = 64 / bits;
+    for (size_t w = 0; w < words.size(); w++) {
+        std::uint64_t word = 0;
+        const std::uint8_t* s = src + w * perWord;
+        for (int j = 0; j < perWord; j++) {
+            std::uint64_t v = (bits == 8) ? s[j] : lut[s[j]];
+            word |= v << (j * bits);
+        }
+        words[w] = word;
+    }
+}
+
+// =============================================================================
+// Store
+// =============================================================================
+// Decompresses into a plain tile array.
+void TileStorage::store(TileArray2D& tiles) const {
+
+    std::uint8_t* dst = &tiles[0][0];
+
+    if (bits == 0) {
+        std::memset(dst, palette[0], CHUNK_TILES);
+        return;
+    }
+
+    int perWord = 64 / bits;
+    std::uint64_t mask = (std::uint64_t(1) << bits) - 1;
+    for (size_t w = 0; w < words.size(); w++) {
+        std::uint64_t word = words[w];
+        std::uint8_t* d = dst + w * perWord;
+        if (bits == 8) {
+            for (int j = 0; j < perWord; j++) {
+                d[j] = std::uint8_t(word >> (j * 8));
+            }
+        }
+        else {
+            for (int j = 0; j < perWord; j++) {
+                d[j] = palette[(word >> (j * bits)) & mask];
+            }
+        }
+    }
+}
+
+// =============================================================================
+// Get
+// =============================================================================
+std::uint8_t TileStorage::get(int i) const {
+
+    if (bits == 0) {
+        return palette[0];
+    }
+
+    int bit = i * bits;
+    std::uint64_t v = (words[bit >> 6] >> (bit & 63)) & ((std::uint64_t(1) << bits) - 1);
+    return (bits == 8) ? std::uint8_t(v) : palette[v];
+}
+
+// =============================================================================
+// Set
+// =============================================================================
+void TileStorage::set(int i, std::uint8_t tile) {
+
+    int v = tile;
+    if (bits != 8) {
+        v = find(tile);
+        if (v < 0) {
+
+            // repack when the new id does not fit the current width
+            if (paletteSize >= (1 << bits)) {
+                TileArray2D tiles;
+                store(tiles);
+                (&tiles[0][0])[i] = tile;
+                load(tiles);
+                return;
+            }
+            v = paletteSize;
+            palette[paletteSize++] = tile;
+        }
+        else if (bits == 0) {
+            return;
+        }
+    }
+
+    int bit = i * bits;
+    std::uint64_t mask = ((std::uint64_t(1) << bits) - 1) << (bit & 63);
+    std::uint64_t& word = words[bit >> 6];
+    word = (word & ~mask) | (std::uint64_t(v) << (bit & 63));
+}
+
+// =============================================================================
+// Find
+// =============================================================================
+int TileStorage::find(std::uint8_t tile) const {
+    for (int i = 0; i < paletteSize; i++) {
+        if (palette[i] == tile) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// =============================================================================
+// Encode Tiles RLE
+// =============================================================================
+// Serializes tiles as (run length - 1, tile id) byte pairs in row-major
+// order.  A uniform chunk encodes to 8 bytes.
+void encodeTilesRLE(const TileArray2D& tiles, std::vector<std::uint8_t>& out) {
+
+    const std::uint8_t* src = &tiles[0][0];
+    out.clear();
+
+    int i = 0;
+    while (i < CHUNK_TILES) {
+        std::uint8_t tile = src[i];
+        int run = 1;
+        while (i + run < CHUNK_TILES && run < TILE_STORAGE_RLE_RUN_MAX && src[i + run] == tile) {
+            run++;
+        }
+        out.push_back(std::uint8_t(run - 1));
+        out.push_back(tile);
+        i += run;
+    }
+}
+
+// =============================================================================
+// Decode Tiles RLE
+// =============================================================================
+// Returns false if the data does not describe exactly one chunk of tiles.
+bool decodeTilesRLE(const std::uint8_t* data, size_t size, TileArray2D& tiles) {
+
+    std::uint8_t* dst = &tiles[0][0];
+
+    if (size % 2 != 0) {
+        return false;
+    }
+
+    int i = 0;
+    for (size_t j = 0; j < size; j += 2) {
+        int run = int(data[j]) + 1;
+        if (i + run > CHUNK_TILES) {
+            return false;
+        }
+        std::memset(dst + i, data[j + 1], run);
+        i += run;
+    }
+    return i == CHUNK_TILES;
+}
+
+#endif // TILE_STORAGE_H
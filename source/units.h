@@ -0,0 +1,110 @@
+#ifndef UNITS_H
+#define UNITS_H
+
+// local includes
+#include "chunk.h"
+#include "ecs.h"
+
+// STL includes
+#include <cstdint>
+
+// =============================================================================
+// Unit Components
+// =============================================================================
+// Positions are world pixels, the same space as Camera and ChunkManager.
+struct Position {
+    float x, y;
+};
+
+struct Velocity {
+    float x, y; // pixels per second
+};
+
+// chunk holding the position, kept current by UnitSystems::updateChunkCells()
+struct ChunkCell {
+    int x, y;
+};
+
+struct UnitType {
+    std::uint8_t type;
+};
+
+// =============================================================================
+// UnitSystems Class
+// =============================================================================
+// Per tick unit systems.  Each one is a plain loop over the component arrays
+// of one archetype chunk at a time.
+class UnitSystems {
+    public:
+        static void spawn(World& world, int numUnits, float halfExtent, float speed, std::uint32_t seed);
+        static void move(World& world, float dt);
+        static void confine(World& world, float halfExtent);
+        static void updateChunkCells(World& world);
+};
+
+// =============================================================================
+// Spawn
+// =============================================================================
+// Scatters units uniformly over the square [-halfExtent, halfExtent] with
+// random headings.  Deterministic for a given seed.
+void UnitSystems::spawn(World& world, int numUnits, float halfExtent, float speed, std::uint32_t seed) {
+
+    std::uint32_t state = seed * 2654435761u + 1u;
+    auto next = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return float(state >> 8) / float(1u << 24); // [0, 1)
+    };
+
+    for (int i = 0; i < numUnits; i++) {
+        Position position = {(next() * 2.0f - 1.0f) * halfExtent, (next() * 2.0f - 1.0f) * halfExtent};
+        Velocity velocity = {(next() * 2.0f - 1.0f) * speed, (next() * 2.0f - 1.0f) * speed};
+        ChunkCell cell = {getChunkCoordX(position.x), getChunkCoordY(position.y)};
+        UnitType type = {std::uint8_t(i & 3)};
+        world.create(position, velocity, cell, type);
+    }
+}
+
+// =============================================================================
+// Move
+// =============================================================================
+void UnitSystems::move(World& world, float dt) {
+    world.forEach<Position, Velocity>([dt](int count, const Entity*, Position* position, Velocity* velocity) {
+        for (int i = 0; i < count; i++) {
+            position[i].x += velocity[i].x * dt;
+            position[i].y += velocity[i].y * dt;
+        }
+    });
+}
+
+// =============================================================================
+// Confine
+// =============================================================================
+// Reflects units off the edges of the square [-halfExtent, halfExtent].
+void UnitSystems::confine(World& world, float halfExtent) {
+    world.forEach<Position, Velocity>([halfExtent](int count, const Entity*, Position* position, Velocity* velocity) {
+        for (int i = 0; i < count; i++) {
+            if (position[i].x < -halfExtent || position[i].x > halfExtent) {
+                velocity[i].x = -velocity[i].x;
+                position[i].x = position[i].x < 0.0f ? -halfExtent : halfExtent;
+            }
+            if (position[i].y < -halfExtent || position[i].y > halfExtent) {
+                velocity[i].y = -velocity[i].y;
+                position[i].y = position[i].y < 0.0f ? -halfExtent : halfExtent;
+            }
+        }
+    });
+}
+
+// =============================================================================
+// Update Chunk Cells
+// =============================================================================
+void UnitSystems::updateChunkCells(World& world) {
+    world.forEach<Position, ChunkCell>([](int count, const Entity*, Position* position, ChunkCell* cell) {
+        for (int i = 0; i < count; i++) {
+            cell[i].x = getChunkCoordX(position[i].x);
+            cell[i].y = getChunkCoordY(position[i].y);
+        }
+    });
+}
+
+#endif // UNITS_H